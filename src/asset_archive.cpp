@@ -0,0 +1,484 @@
+#include "asset_archive.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+namespace CampusSim {
+
+    namespace {
+
+        // ----------------- 文件格式 -----------------
+        //
+        // [ArchiveHeader]
+        // [ArchiveEntry × entryCount]（按路径排序，二分查找）
+        // [路径数据]
+        // [各图片的数据]（每块 8 字节对齐）
+        //
+        // 头部和索引都是 8 字节对齐的小端整数，映射后可以直接按结构体访问。
+
+        constexpr char          ARCHIVE_MAGIC[4] = {'C', 'S', 'A', 'P'};
+        constexpr std::uint32_t BYTE_ORDER_MARK  = 0x01020304u;
+
+        // 图片数据的存放方式
+        enum class ArchiveCompression : std::uint32_t {
+            None = 0,  // 原样存放（压不下去的图片，读取时只有一次拷贝）
+            Lz4  = 1,  // LZ4 块格式
+        };
+
+        // 压缩后至少省下这么多才用压缩版本，否则解压只是白费时间
+        constexpr double MIN_COMPRESSION_SAVING = 0.05;
+
+        struct ArchiveHeader {
+            char          magic[4];
+            std::uint32_t version;
+            std::uint32_t byteOrderMark;
+            std::uint32_t entryCount;
+            std::uint64_t fileSize;
+            std::uint64_t entriesOffset;
+            std::uint64_t pathDataOffset;
+            std::uint64_t pathDataSize;
+        };
+
+        struct ArchiveEntry {
+            std::uint64_t pathOffset;   // 在路径数据中的偏移
+            std::uint32_t pathSize;
+            std::uint32_t compression;  // ArchiveCompression
+            std::uint32_t width;
+            std::uint32_t height;
+            std::uint64_t dataOffset;   // 文件内偏移
+            std::uint64_t dataSize;     // 存放的字节数（压缩后）
+            std::uint64_t sourceSize;   // 打包时源文件的大小和修改时间，对不上说明包已过期
+            std::int64_t  sourceMtime;
+        };
+
+        static_assert(sizeof(ArchiveHeader) % 8 == 0, "ArchiveHeader must stay 8-byte aligned");
+        static_assert(sizeof(ArchiveEntry)  % 8 == 0, "ArchiveEntry must stay 8-byte aligned");
+
+        bool isLittleEndianHost() {
+            std::uint32_t probe = 1;
+            std::uint8_t first = 0;
+            std::memcpy(&first, &probe, 1);
+            return first == 1;
+        }
+
+        // 源文件的大小和修改时间；文件不存在时返回 false
+        bool statSource(const std::string& path, std::uint64_t& size, std::int64_t& mtime) {
+            namespace fs = std::filesystem;
+            std::error_code ec;
+            size = fs::file_size(path, ec);
+            if (ec) return false;
+            mtime = static_cast<std::int64_t>(fs::last_write_time(path, ec).time_since_epoch().count());
+            return !ec;
+        }
+
+        // ----------------- LZ4 块格式 -----------------
+        //
+        // 一串序列：令牌（高 4 位字面量长度，低 4 位匹配长度 - 4，等于 15 时后面跟 255 累加的扩展字节）、
+        // 字面量、2 字节小端回溯距离。最后一个序列只有字面量。
+        // 规范要求最后 5 个字节必须是字面量，最后一个匹配至少在结尾前 12 个字节开始
+
+        constexpr std::size_t MIN_MATCH     = 4;   // 格式允许的最短匹配
+        constexpr std::size_t LAST_LITERALS = 5;
+        constexpr std::size_t MATCH_LIMIT   = 12;
+        constexpr std::size_t MAX_DISTANCE  = 65535;
+        constexpr int         HASH_BITS     = 16;
+
+        // 编码时放弃更短的匹配：照片里 4、5 字节的匹配省不了几个字节，却让解压多出大量短序列。
+        // 在现有背景上（1200×801 到 4032×3024 的照片）这样解压快一倍多，压缩率也更好
+        constexpr std::size_t MIN_USEFUL_MATCH = 6;
+
+        std::uint32_t read32(const std::uint8_t* p) {
+            std::uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        std::uint32_t hash4(std::uint32_t v) {
+            return (v * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        // 长度超过 15 的部分：每字节 255，最后一个字节小于 255
+        void writeLength(std::vector<std::uint8_t>& out, std::size_t length) {
+            while (length >= 255) {
+                out.push_back(255);
+                length -= 255;
+            }
+            out.push_back(static_cast<std::uint8_t>(length));
+        }
+
+        void writeSequence(std::vector<std::uint8_t>& out, const std::uint8_t* literals, std::size_t literalCount,
+                           std::size_t distance, std::size_t matchLength) {
+            std::size_t extra = matchLength - MIN_MATCH;
+            std::uint8_t token = static_cast<std::uint8_t>(
+                (std::min<std::size_t>(literalCount, 15) << 4) | std::min<std::size_t>(extra, 15));
+            out.push_back(token);
+            if (literalCount >= 15) writeLength(out, literalCount - 15);
+            out.insert(out.end(), literals, literals + literalCount);
+
+            out.push_back(static_cast<std::uint8_t>(distance));
+            out.push_back(static_cast<std::uint8_t>(distance >> 8));
+            if (extra >= 15) writeLength(out, extra - 15);
+        }
+
+        void writeLastLiterals(std::vector<std::uint8_t>& out, const std::uint8_t* literals, std::size_t literalCount) {
+            out.push_back(static_cast<std::uint8_t>(std::min<std::size_t>(literalCount, 15) << 4));
+            if (literalCount >= 15) writeLength(out, literalCount - 15);
+            out.insert(out.end(), literals, literals + literalCount);
+        }
+
+        // 按 16 字节一块拷贝，最多多写 15 个字节（之后会被覆盖）。
+        // 照片的序列大多很短，定长的 memcpy 比按长度调用快得多；调用方保证两端都留有余量
+        constexpr std::size_t WILD_COPY = 16;
+
+        void wildCopy(std::uint8_t* dst, const std::uint8_t* src, std::size_t size) {
+            std::uint8_t* const end = dst + size;
+            do {
+                std::memcpy(dst, src, WILD_COPY);
+                dst += WILD_COPY;
+                src += WILD_COPY;
+            } while (dst < end);
+        }
+
+        // 读一个扩展长度；越界时返回 false
+        bool readLength(const std::uint8_t*& ip, const std::uint8_t* end, std::size_t& length) {
+            std::uint8_t b = 0;
+            do {
+                if (ip == end) return false;
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+            return true;
+        }
+
+    } // namespace
+
+    void compressBlock(const std::uint8_t* src, std::size_t size, std::vector<std::uint8_t>& out) {
+        out.clear();
+        out.reserve(size + size / 255 + 16);
+
+        std::size_t anchor = 0;  // 尚未输出的字面量起点
+        if (size > MATCH_LIMIT) {
+            // 哈希表记录每个 4 字节序列最后一次出现的位置（贪心匹配，不找最长）
+            std::vector<std::uint32_t> table(std::size_t(1) << HASH_BITS, 0);
+            const std::size_t matchEnd = size - LAST_LITERALS;
+            std::size_t i = 0;
+
+            while (i + MATCH_LIMIT <= size) {
+                std::uint32_t seq = read32(src + i);
+                std::uint32_t& slot = table[hash4(seq)];
+                std::size_t candidate = slot;
+                slot = static_cast<std::uint32_t>(i);
+
+                if (candidate >= i || i - candidate > MAX_DISTANCE || read32(src + candidate) != seq) {
+                    // 越久没有匹配跳得越快，压不动的数据不至于太慢
+                    i += 1 + ((i - anchor) >> 6);
+                    continue;
+                }
+
+                std::size_t end = i + MIN_MATCH;
+                while (end < matchEnd && src[end] == src[candidate + (end - i)]) ++end;
+                if (end - i < MIN_USEFUL_MATCH) {
+                    i += 1 + ((i - anchor) >> 6);
+                    continue;
+                }
+                // 向前扩展到字面量里
+                while (i > anchor && candidate > 0 && src[i - 1] == src[candidate - 1]) {
+                    --i;
+                    --candidate;
+                }
+
+                writeSequence(out, src + anchor, i - anchor, i - candidate, end - i);
+                i = anchor = end;
+                if (i + MATCH_LIMIT <= size) {
+                    table[hash4(read32(src + i - 2))] = static_cast<std::uint32_t>(i - 2);
+                }
+            }
+        }
+        writeLastLiterals(out, src + anchor, size - anchor);
+    }
+
+    bool decompressBlock(const std::uint8_t* src, std::size_t size, std::uint8_t* dst, std::size_t dstSize) {
+        const std::uint8_t* ip = src;
+        const std::uint8_t* const inEnd = src + size;
+        std::uint8_t* op = dst;
+        std::uint8_t* const outEnd = dst + dstSize;
+
+        while (ip < inEnd) {
+            std::uint8_t token = *ip++;
+
+            std::size_t literals = token >> 4;
+            if (literals == 15 && !readLength(ip, inEnd, literals)) return false;
+            if (literals > static_cast<std::size_t>(inEnd - ip) ||
+                literals > static_cast<std::size_t>(outEnd - op)) return false;
+            if (static_cast<std::size_t>(inEnd - ip) >= literals + WILD_COPY &&
+                static_cast<std::size_t>(outEnd - op) >= literals + WILD_COPY) {
+                wildCopy(op, ip, literals);
+            } else {
+                std::memcpy(op, ip, literals);
+            }
+            ip += literals;
+            op += literals;
+            if (ip == inEnd) break;  // 最后一个序列没有匹配
+
+            if (inEnd - ip < 2) return false;
+            std::size_t distance = ip[0] | (static_cast<std::size_t>(ip[1]) << 8);
+            ip += 2;
+            if (distance == 0 || distance > static_cast<std::size_t>(op - dst)) return false;
+
+            std::size_t length = token & 15;
+            if (length == 15 && !readLength(ip, inEnd, length)) return false;
+            length += MIN_MATCH;
+            if (length > static_cast<std::size_t>(outEnd - op)) return false;
+
+            if (distance >= WILD_COPY && static_cast<std::size_t>(outEnd - op) >= length + WILD_COPY) {
+                wildCopy(op, op - distance, length);
+                op += length;
+                continue;
+            }
+            // 距离小于长度时源和目标重叠，内容以 distance 为周期重复：
+            // 每拷一段，可以回溯的距离就翻倍，纯色区域（距离 4）也只需要几次 memcpy
+            while (length > 0) {
+                std::size_t n = std::min(distance, length);
+                std::memcpy(op, op - distance, n);
+                op += n;
+                length -= n;
+                distance += n;
+            }
+        }
+        return op == outEnd;
+    }
+
+    // ----------------- 写包 -----------------
+
+    bool writeAssetArchive(const std::vector<ArchiveImage>& images, const std::filesystem::path& outPath) {
+        if (!isLittleEndianHost()) {
+            std::cerr << "资源包只支持小端平台\n";
+            return false;
+        }
+
+        std::vector<const ArchiveImage*> sorted;
+        for (const auto& image : images) sorted.push_back(&image);
+        std::sort(sorted.begin(), sorted.end(), [](const ArchiveImage* a, const ArchiveImage* b) {
+            return a->path < b->path;
+        });
+
+        std::vector<ArchiveEntry> entries;
+        std::vector<std::vector<std::uint8_t>> payloads;
+        std::string pathData;
+        for (std::size_t k = 0; k < sorted.size(); ++k) {
+            const ArchiveImage& image = *sorted[k];
+            if (k > 0 && image.path == sorted[k - 1]->path) continue;  // 同一路径只存一份
+            if (image.pixels.size() != std::size_t(image.width) * image.height * 4u) {
+                std::cerr << "图片尺寸与像素数据不符: " << image.path << "\n";
+                return false;
+            }
+
+            ArchiveEntry entry{};
+            entry.pathOffset = pathData.size();
+            entry.pathSize   = static_cast<std::uint32_t>(image.path.size());
+            entry.width      = image.width;
+            entry.height     = image.height;
+            pathData += image.path;
+            if (!statSource(image.path, entry.sourceSize, entry.sourceMtime)) {
+                entry.sourceSize  = 0;
+                entry.sourceMtime = 0;
+            }
+
+            std::vector<std::uint8_t> payload;
+            compressBlock(image.pixels.data(), image.pixels.size(), payload);
+            if (payload.size() <= image.pixels.size() * (1.0 - MIN_COMPRESSION_SAVING)) {
+                entry.compression = static_cast<std::uint32_t>(ArchiveCompression::Lz4);
+            } else {
+                entry.compression = static_cast<std::uint32_t>(ArchiveCompression::None);
+                payload = image.pixels;
+            }
+            entry.dataSize = payload.size();
+
+            entries.push_back(entry);
+            payloads.push_back(std::move(payload));
+        }
+
+        auto align8 = [](std::uint64_t offset) { return (offset + 7) & ~std::uint64_t(7); };
+
+        ArchiveHeader header{};
+        std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+        header.version        = ASSET_ARCHIVE_VERSION;
+        header.byteOrderMark  = BYTE_ORDER_MARK;
+        header.entryCount     = static_cast<std::uint32_t>(entries.size());
+        header.entriesOffset  = sizeof(ArchiveHeader);
+        header.pathDataOffset = header.entriesOffset + entries.size() * sizeof(ArchiveEntry);
+        header.pathDataSize   = pathData.size();
+
+        std::uint64_t offset = align8(header.pathDataOffset + pathData.size());
+        for (auto& entry : entries) {
+            entry.dataOffset = offset;
+            offset = align8(offset + entry.dataSize);
+        }
+        header.fileSize = offset;
+
+        std::filesystem::path tmpPath = outPath;
+        tmpPath += ".tmp";
+        {
+            std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!f) {
+                std::cerr << "无法写入资源包: " << tmpPath << "\n";
+                return false;
+            }
+            const char padding[8] = {};
+            auto write = [&](const void* data, std::size_t size) {
+                f.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            };
+            auto padTo = [&](std::uint64_t target) {
+                auto pos = static_cast<std::uint64_t>(f.tellp());
+                if (target > pos) write(padding, static_cast<std::size_t>(target - pos));
+            };
+
+            write(&header, sizeof(header));
+            write(entries.data(), entries.size() * sizeof(ArchiveEntry));
+            write(pathData.data(), pathData.size());
+            for (std::size_t k = 0; k < entries.size(); ++k) {
+                padTo(entries[k].dataOffset);
+                write(payloads[k].data(), payloads[k].size());
+            }
+            padTo(header.fileSize);
+            if (!f) {
+                std::cerr << "写入资源包失败: " << tmpPath << "\n";
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, outPath, ec);
+        if (ec) {
+            std::cerr << "无法替换资源包 " << outPath << ": " << ec.message() << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    // ----------------- 读包 -----------------
+
+    bool AssetArchive::open(const std::filesystem::path& path) {
+        file_.close();
+        entryCount_ = 0;
+        stale_.clear();
+
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec)) return false;
+        if (!isLittleEndianHost() || !file_.open(path)) return false;
+
+        auto corrupt = [&]() {
+            std::cerr << "资源包已损坏: " << path << "，改读散文件\n";
+            file_.close();
+            return false;
+        };
+
+        if (file_.size() < sizeof(ArchiveHeader)) return corrupt();
+        const auto& header = *reinterpret_cast<const ArchiveHeader*>(file_.data());
+        if (std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 ||
+            header.byteOrderMark != BYTE_ORDER_MARK) {
+            return corrupt();
+        }
+        if (header.version != ASSET_ARCHIVE_VERSION) {
+            std::cerr << "资源包版本不符（" << header.version << "），改读散文件（请重新运行 assetpack）\n";
+            file_.close();
+            return false;
+        }
+
+        // 索引和每个条目的区间都先校验一遍，之后 load 不必再检查偏移
+        const std::uint64_t fileSize = file_.size();
+        if (header.fileSize != fileSize ||
+            header.entriesOffset > fileSize ||
+            header.entryCount > (fileSize - header.entriesOffset) / sizeof(ArchiveEntry) ||
+            header.pathDataOffset > fileSize || header.pathDataSize > fileSize - header.pathDataOffset) {
+            return corrupt();
+        }
+        const auto* entries = reinterpret_cast<const ArchiveEntry*>(file_.data() + header.entriesOffset);
+        const char* pathData = reinterpret_cast<const char*>(file_.data() + header.pathDataOffset);
+        for (std::uint32_t k = 0; k < header.entryCount; ++k) {
+            const ArchiveEntry& e = entries[k];
+            if (e.pathOffset > header.pathDataSize || e.pathSize > header.pathDataSize - e.pathOffset ||
+                e.dataOffset > fileSize || e.dataSize > fileSize - e.dataOffset) {
+                return corrupt();
+            }
+            // LZ4 的压缩比不会超过 255:1，尺寸对不上的条目不可能解压成功
+            std::uint64_t bytes = std::uint64_t(e.width) * e.height * 4u;
+            bool sizeOk = e.compression == static_cast<std::uint32_t>(ArchiveCompression::None)
+                ? e.dataSize == bytes
+                : e.compression == static_cast<std::uint32_t>(ArchiveCompression::Lz4) && bytes <= e.dataSize * 255u;
+            if (!sizeOk) return corrupt();
+            if (k > 0) {
+                const ArchiveEntry& prev = entries[k - 1];
+                std::string_view a(pathData + prev.pathOffset, prev.pathSize);
+                std::string_view b(pathData + e.pathOffset, e.pathSize);
+                if (!(a < b)) return corrupt();
+            }
+        }
+        entryCount_ = header.entryCount;
+
+        // 改过的源图片以散文件为准；源文件不在了（只发布资源包）时照常用包里的
+        stale_.assign(entryCount_, false);
+        std::size_t staleCount = 0;
+        for (std::size_t k = 0; k < entryCount_; ++k) {
+            const ArchiveEntry& e = entries[k];
+            std::string source(pathData + e.pathOffset, e.pathSize);
+            std::uint64_t size = 0;
+            std::int64_t mtime = 0;
+            if (statSource(source, size, mtime) && (size != e.sourceSize || mtime != e.sourceMtime)) {
+                stale_[k] = true;
+                ++staleCount;
+            }
+        }
+        if (staleCount > 0) {
+            std::cerr << "资源包中 " << staleCount << " 张图片已过期，这些改读散文件（请重新运行 assetpack）\n";
+        }
+        return true;
+    }
+
+    std::size_t AssetArchive::find(std::string_view path) const {
+        const auto& header = *reinterpret_cast<const ArchiveHeader*>(file_.data());
+        const auto* entries = reinterpret_cast<const ArchiveEntry*>(file_.data() + header.entriesOffset);
+        const char* pathData = reinterpret_cast<const char*>(file_.data() + header.pathDataOffset);
+        auto pathOf = [&](const ArchiveEntry& e) { return std::string_view(pathData + e.pathOffset, e.pathSize); };
+
+        const ArchiveEntry* it = std::lower_bound(entries, entries + entryCount_, path,
+            [&](const ArchiveEntry& e, std::string_view key) { return pathOf(e) < key; });
+        if (it == entries + entryCount_ || pathOf(*it) != path) return entryCount_;
+        return static_cast<std::size_t>(it - entries);
+    }
+
+    bool AssetArchive::load(std::string_view path, std::uint32_t& width, std::uint32_t& height,
+                            std::vector<std::uint8_t>& pixels) const {
+        if (!isOpen()) return false;
+        std::size_t k = find(path);
+        if (k == entryCount_ || stale_[k]) return false;
+
+        const auto& header = *reinterpret_cast<const ArchiveHeader*>(file_.data());
+        const auto& entry = reinterpret_cast<const ArchiveEntry*>(file_.data() + header.entriesOffset)[k];
+        const std::uint8_t* data = file_.data() + entry.dataOffset;
+        std::size_t bytes = std::size_t(entry.width) * entry.height * 4u;
+
+        pixels.resize(bytes);
+        bool ok = false;
+        switch (static_cast<ArchiveCompression>(entry.compression)) {
+            case ArchiveCompression::None:
+                ok = entry.dataSize == bytes;
+                if (ok) std::memcpy(pixels.data(), data, bytes);
+                break;
+            case ArchiveCompression::Lz4:
+                ok = decompressBlock(data, static_cast<std::size_t>(entry.dataSize), pixels.data(), bytes);
+                break;
+        }
+        if (!ok) {
+            std::cerr << "资源包中的图片已损坏: " << path << "\n";
+            return false;
+        }
+        width  = entry.width;
+        height = entry.height;
+        return true;
+    }
+
+} // namespace CampusSim
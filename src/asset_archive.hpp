@@ -0,0 +1,62 @@
+#pragma once
+
+#include "mapped_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CampusSim {
+
+    // 资源包的格式版本：格式变化时递增，旧包会被忽略
+    constexpr std::uint32_t ASSET_ARCHIVE_VERSION = 1;
+
+    // 游戏默认读取的资源包路径（由 assetpack 生成）
+    constexpr const char* ASSET_ARCHIVE_PATH = "assets.pack";
+
+    // 打包用的一张已解码图片
+    struct ArchiveImage {
+        std::string path;                 // 游戏里引用的路径（Scene::backgroundPath），也是查找的键
+        std::uint32_t width  = 0;
+        std::uint32_t height = 0;
+        std::vector<std::uint8_t> pixels; // width × height × 4 字节 RGBA
+    };
+
+    // LZ4 块格式的压缩和解压（不带帧头）。解压时必须知道原始大小，
+    // 数据损坏或大小不符时返回 false，不会越界读写
+    void compressBlock(const std::uint8_t* src, std::size_t size, std::vector<std::uint8_t>& out);
+    bool decompressBlock(const std::uint8_t* src, std::size_t size, std::uint8_t* dst, std::size_t dstSize);
+
+    // 把解码好的图片写成资源包（先写临时文件再改名）。
+    // 源文件（path 指向的 PNG）的大小和修改时间记进索引，游戏据此判断包是否过期
+    bool writeAssetArchive(const std::vector<ArchiveImage>& images, const std::filesystem::path& outPath);
+
+    // 内存映射的资源包：索引按路径排序，图片数据按需解压。
+    // 打开后只读，多个线程可以同时 load
+    class AssetArchive {
+    public:
+        // 映射资源包；不存在时安静地返回 false，版本不符或损坏时报错后返回 false。
+        // 源文件已被修改的条目记为过期（报告一次），之后 load 不再返回它们
+        bool open(const std::filesystem::path& path);
+
+        bool isOpen() const { return file_.isOpen(); }
+        std::size_t size() const { return entryCount_; }
+
+        // 解压 path 对应的图片到 pixels（width × height × 4 字节 RGBA）。
+        // 不在包里、已过期或数据损坏时返回 false，调用方改读散文件
+        bool load(std::string_view path, std::uint32_t& width, std::uint32_t& height,
+                  std::vector<std::uint8_t>& pixels) const;
+
+    private:
+        // 找不到时返回 entryCount_
+        std::size_t find(std::string_view path) const;
+
+        MappedFile file_;
+        std::size_t entryCount_ = 0;
+        std::vector<bool> stale_;
+    };
+
+} // namespace CampusSim
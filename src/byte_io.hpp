@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 紧凑二进制格式的读写小工具：无符号整数用 LEB128 变长编码，有符号整数先做 zigzag，
+// float 按 IEEE 位模式写 4 字节小端。逐字节读写，与主机字节序无关
+
+namespace CampusSim {
+
+    class ByteWriter {
+    public:
+        explicit ByteWriter(std::vector<std::uint8_t>& out) : out_(out) {}
+
+        void u8(std::uint8_t v) { out_.push_back(v); }
+
+        void varint(std::uint64_t v) {
+            while (v >= 0x80) {
+                out_.push_back(static_cast<std::uint8_t>(v | 0x80));
+                v >>= 7;
+            }
+            out_.push_back(static_cast<std::uint8_t>(v));
+        }
+
+        void svarint(std::int64_t v) {
+            varint((static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63));
+        }
+
+        void u32le(std::uint32_t v) {
+            for (int i = 0; i < 4; ++i) out_.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+        }
+
+        void f32(float v) {
+            std::uint32_t bits = 0;
+            std::memcpy(&bits, &v, sizeof(bits));
+            u32le(bits);
+        }
+
+        void bytes(const void* data, std::size_t size) {
+            const auto* p = static_cast<const std::uint8_t*>(data);
+            out_.insert(out_.end(), p, p + size);
+        }
+
+        // 长度（varint）+ 内容
+        void str(std::string_view s) {
+            varint(s.size());
+            bytes(s.data(), s.size());
+        }
+
+    private:
+        std::vector<std::uint8_t>& out_;
+    };
+
+    // 越界或编码非法时置 ok() 为 false，之后的读取都返回 0 / 空串，调用方最后检查一次即可
+    class ByteReader {
+    public:
+        ByteReader(const std::uint8_t* data, std::size_t size) : p_(data), end_(data + size) {}
+
+        bool ok() const { return ok_; }
+        bool atEnd() const { return p_ == end_; }
+        std::size_t remaining() const { return static_cast<std::size_t>(end_ - p_); }
+
+        std::uint8_t u8() {
+            if (!ok_ || p_ == end_) return fail();
+            return *p_++;
+        }
+
+        std::uint64_t varint() {
+            std::uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (!ok_ || p_ == end_) return fail();
+                std::uint8_t b = *p_++;
+                v |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+                if (!(b & 0x80)) return v;
+            }
+            return fail();
+        }
+
+        std::int64_t svarint() {
+            std::uint64_t v = varint();
+            return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+        }
+
+        std::uint32_t u32le() {
+            if (!ok_ || remaining() < 4) return fail();
+            std::uint32_t v = 0;
+            for (int i = 0; i < 4; ++i) v |= static_cast<std::uint32_t>(*p_++) << (8 * i);
+            return v;
+        }
+
+        float f32() {
+            std::uint32_t bits = u32le();
+            float v = 0.f;
+            std::memcpy(&v, &bits, sizeof(v));
+            return v;
+        }
+
+        std::string str() {
+            return std::string(strView());
+        }
+
+        // 不复制：指向原始数据，只在数据存活期间有效
+        std::string_view strView() {
+            std::uint64_t size = varint();
+            if (!ok_ || size > remaining()) {
+                fail();
+                return {};
+            }
+            std::string_view s(reinterpret_cast<const char*>(p_), static_cast<std::size_t>(size));
+            p_ += size;
+            return s;
+        }
+
+        // 跳过 size 字节，返回它们的起点
+        const std::uint8_t* skip(std::size_t size) {
+            if (!ok_ || size > remaining()) {
+                fail();
+                return nullptr;
+            }
+            const std::uint8_t* at = p_;
+            p_ += size;
+            return at;
+        }
+
+        const std::uint8_t* position() const { return p_; }
+
+    private:
+        std::uint8_t fail() {
+            ok_ = false;
+            p_ = end_;
+            return 0;
+        }
+
+        const std::uint8_t* p_;
+        const std::uint8_t* end_;
+        bool ok_ = true;
+    };
+
+} // namespace CampusSim
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "parse_number.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+// 命令行工具共用的参数解析：数值参数不合法时报错退出，不抛异常
+
+namespace CampusSim {
+
+    // 解析选项 name 的数值参数；不合法时报错、调用 printUsage，并以退出码 2 结束（与用法错误一致）
+    template <typename T, typename Usage>
+    void parseNumberArg(std::string_view name, std::string_view text, T& out, Usage&& printUsage) {
+        if (parseNumber(text, out)) return;
+        std::cerr << "参数 " << name << " 的值不是合法的数: " << text << "\n";
+        printUsage();
+        std::exit(2);
+    }
+
+} // namespace CampusSim
@@ -0,0 +1,216 @@
+#include "engine.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace CampusSim {
+
+    void applyDelta(Stats& stats, const Choice& choice) {
+        stats.physique        = clampStat(stats.physique        + choice.dPhysique);
+        stats.study           = clampStat(stats.study           + choice.dStudy);
+        stats.network         = clampStat(stats.network         + choice.dNetwork);
+        stats.reputation      = clampStat(stats.reputation      + choice.dReputation);
+        stats.experience      = clampStat(stats.experience      + choice.dExperience);
+        stats.san             = clampStat(stats.san             + choice.dSan);
+        stats.GongnengLecture = clampStat(stats.GongnengLecture + choice.dGongnengLecture);
+        stats.volunteer       = clampStat(stats.volunteer       + choice.dVolunteer);
+        stats.socialPractice  = clampStat(stats.socialPractice  + choice.dSocialPractice);
+    }
+
+    int shownSeconds(float remaining) {
+        return remaining > 0.f ? static_cast<int>(std::ceil(remaining)) : 0;
+    }
+
+    namespace {
+
+        // std::push_heap 默认是最大堆，比较反过来得到最早的事件在堆顶
+        struct LaterTick {
+            template <typename Tick>
+            bool operator()(const Tick& a, const Tick& b) const { return a.at > b.at; }
+        };
+
+    } // namespace
+
+    Engine::Engine(const StoryGraph& story)
+        : story_(story) {}
+
+    bool Engine::start(const std::string& sceneId) {
+        std::uint32_t scene = story_.findScene(sceneId);
+        if (scene == NO_SCENE) return false;
+
+        state_ = GameState{};
+        now_ = 0.0;
+        enterScene(scene);
+        return true;
+    }
+
+    bool Engine::choiceVisible(std::size_t choiceIndex) const {
+        const Choice& choice = currentChoices()[choiceIndex];
+        if (!requirementsMet(choice, state_.stats, state_.flags)) return false;
+        if (choice.timed && timers_[choiceIndex].shown <= 0) return false;
+        return true;
+    }
+
+    int Engine::countdown(std::size_t choiceIndex) const {
+        return currentChoices()[choiceIndex].timed ? timers_[choiceIndex].shown : 0;
+    }
+
+    void Engine::visibleChoices(std::vector<std::size_t>& out) const {
+        out.clear();
+        auto choices = currentChoices();
+        for (std::size_t i = 0; i < choices.size(); ++i) {
+            if (choiceVisible(i)) {
+                out.push_back(i);
+            }
+        }
+    }
+
+    Engine::ChoiceOutcome Engine::choose(std::size_t choiceIndex) {
+        ChoiceOutcome outcome;
+        auto choices = currentChoices();
+        if (choiceIndex >= choices.size()) return outcome;
+
+        const Choice& choice = choices[choiceIndex];
+        if (!choiceVisible(choiceIndex)) return outcome;
+        outcome.applied = true;
+
+        // 1. 改属性
+        applyDelta(state_.stats, choice);
+
+        // 2. 记录 flags
+        for (auto f : choice.setFlagIds) {
+            state_.flags.set(f);
+        }
+        outcome.flagsChanged = !choice.setFlagIds.empty();
+
+        // 3. 计算真正要去的场景（目标已在链接时解析成下标，只有重定向规则要看属性和 flags）
+        std::uint32_t target = resolveNextScene(story_, choice, state_.stats, state_.flags);
+        if (target != NO_SCENE) {
+            enterScene(target);
+            outcome.sceneChanged = true;
+        }
+        // 找不到的目标已在载入时报告过，这里停留在当前场景
+        return outcome;
+    }
+
+    bool Engine::advance(float dt) {
+        if (dt > 0.f) now_ += dt;
+
+        bool changed = false;
+        while (!ticks_.empty() && ticks_.front().at <= now_) {
+            std::pop_heap(ticks_.begin(), ticks_.end(), LaterTick{});
+            std::uint32_t choice = ticks_.back().choice;
+            ticks_.pop_back();
+
+            // 一次推进了好几秒时直接跳到当前应显示的值；至少减一，保证事件一定向前走
+            Timer& timer = timers_[choice];
+            int shown = shownSeconds(static_cast<float>(timer.deadline - now_));
+            timer.shown = std::max(0, std::min(timer.shown - 1, shown));
+            if (timer.shown > 0) pushTick(choice);
+            changed = true;
+        }
+        return changed;
+    }
+
+    std::optional<float> Engine::nextDisplayChange() const {
+        // 堆里只有当前场景还在倒计时的选项，通常只有一两个
+        std::optional<float> next;
+        auto choices = currentChoices();
+        for (const auto& tick : ticks_) {
+            if (!requirementsMet(choices[tick.choice], state_.stats, state_.flags)) continue;
+            float wait = static_cast<float>(std::max(0.0, tick.at - now_));
+            if (!next || wait < *next) next = wait;
+        }
+        return next;
+    }
+
+    void Engine::storyChanged(const std::string& currentId, bool currentReplaced) {
+        std::uint32_t scene = story_.findScene(currentId);
+        if (scene == NO_SCENE) return;  // 热重载只增改不删，当前场景总能找到
+
+        if (currentReplaced) {
+            enterScene(scene);
+        } else {
+            current_ = scene;
+        }
+    }
+
+    SaveState Engine::snapshot() const {
+        SaveState saved;
+        saved.sceneId = currentScene().id;
+        saved.stats   = state_.stats;
+        for (std::uint32_t id = 0; id < story_.flags.size(); ++id) {
+            if (state_.flags.test(id)) saved.flags.push_back(story_.flags.name(id));
+        }
+        auto choices = currentChoices();
+        for (std::size_t i = 0; i < choices.size(); ++i) {
+            if (choices[i].timed) {
+                float remaining = timers_[i].shown > 0
+                    ? static_cast<float>(std::max(0.0, timers_[i].deadline - now_))
+                    : 0.f;
+                saved.timers.push_back({static_cast<std::uint32_t>(i), remaining});
+            }
+        }
+        return saved;
+    }
+
+    bool Engine::restore(const SaveState& saved) {
+        std::uint32_t scene = story_.findScene(saved.sceneId);
+        if (scene == NO_SCENE) return false;
+
+        state_ = GameState{};
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            state_.stats.*STAT_FIELDS[k] = clampStat(saved.stats.*STAT_FIELDS[k]);
+        }
+        // 剧情图只读：已经没有任何选项引用的 flag 不会再影响剧情，直接丢弃
+        for (const auto& name : saved.flags) {
+            std::uint32_t id = story_.flags.find(name);
+            if (id != FlagTable::NONE) state_.flags.set(id);
+        }
+
+        enterScene(scene);
+        auto choices = currentChoices();
+        bool retimed = false;
+        for (const auto& t : saved.timers) {
+            if (t.choice >= choices.size() || !choices[t.choice].timed) continue;
+            startTimer(t.choice, std::clamp(t.remaining, 0.f, choices[t.choice].timeLimit));
+            retimed = true;
+        }
+        if (retimed) {
+            // 替换掉 enterScene 按满时长排好的事件
+            ticks_.clear();
+            for (std::uint32_t i = 0; i < choices.size(); ++i) {
+                if (choices[i].timed && timers_[i].shown > 0) pushTick(i);
+            }
+        }
+        return true;
+    }
+
+    // 进入一个新场景时，该场景所有限时选项从满时长开始计时
+    void Engine::enterScene(std::uint32_t scene) {
+        current_ = scene;
+        auto choices = currentChoices();
+        // 只有限时选项的槽位会被读到，其余的不必清零
+        if (timers_.size() < choices.size()) timers_.resize(choices.size());
+        ticks_.clear();
+        for (std::uint32_t i = 0; i < choices.size(); ++i) {
+            if (choices[i].timed) {
+                startTimer(i, choices[i].timeLimit);
+                if (timers_[i].shown > 0) pushTick(i);
+            }
+        }
+    }
+
+    void Engine::startTimer(std::uint32_t choice, float remaining) {
+        timers_[choice].deadline = now_ + remaining;
+        timers_[choice].shown    = shownSeconds(remaining);
+    }
+
+    // 显示值为 shown 时，剩余时间降到 shown - 1 那一刻显示变化（shown 为 1 时即超时）
+    void Engine::pushTick(std::uint32_t choice) {
+        const Timer& timer = timers_[choice];
+        ticks_.push_back({timer.deadline - (timer.shown - 1), choice});
+        std::push_heap(ticks_.begin(), ticks_.end(), LaterTick{});
+    }
+
+} // namespace CampusSim
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "story_graph.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace CampusSim {
+
+    //上下限
+#ifndef STAT_MAX_VALUE
+    constexpr int STAT_MAX = 100;
+#else
+    constexpr int STAT_MAX = STAT_MAX_VALUE;
+#endif
+    constexpr int STAT_MIN = -100;
+
+    inline int clampStat(int v) {
+        if (v < STAT_MIN) return STAT_MIN;
+        if (v > STAT_MAX) return STAT_MAX;
+        return v;
+    }
+
+    // 把选项的九项属性变化加到 stats 上，并夹到 [STAT_MIN, STAT_MAX]
+    void applyDelta(Stats& stats, const Choice& choice);
+
+    // 限时选项显示的整秒数（向上取整，时间耗尽为 0）
+    int shownSeconds(float remaining);
+
+    // 存档用的运行状态快照：场景和 flag 都按名字记录，不依赖载入时分配的下标和 ID，
+    // 剧情改动（新增场景、flag）之后旧存档仍能读回
+    struct SaveState {
+        struct Timer {
+            std::uint32_t choice    = 0;    // 当前场景内的选项下标
+            float         remaining = 0.f;  // 剩余秒数
+        };
+
+        std::string sceneId;
+        Stats stats;
+        std::vector<std::string> flags;
+        std::vector<Timer> timers;  // 当前场景各限时选项的剩余时间
+    };
+
+    // 不依赖任何图形库的剧情引擎：载入剧情、列出可见选项、应用选项、推进时间。
+    // 图形界面和命令行工具都只是它的外壳。
+    //
+    // 剧情图只读：每局的状态（属性、flags、限时选项的计时器）都在 Engine 里，
+    // 同一份 StoryGraph 可以同时给任意多个 Engine（包括不同线程里的）使用
+    class Engine {
+    public:
+        // 选择一个选项后发生了什么，界面据此决定哪些部分要重排
+        struct ChoiceOutcome {
+            bool applied      = false;  // 选项有效且已应用
+            bool flagsChanged = false;  // 设置了新的 flag
+            bool sceneChanged = false;  // 进入了新场景（目标不存在时停留在原场景）
+        };
+
+        explicit Engine(const StoryGraph& story);
+
+        // 从指定场景开始新的一局（属性和 flags 清零）；场景不存在时返回 false
+        bool start(const std::string& sceneId = "start");
+
+        // 把当前可见选项在本场景中的下标（按原顺序）写进 out
+        void visibleChoices(std::vector<std::size_t>& out) const;
+
+        // 选择当前场景的第 choiceIndex 个选项（场景内下标，应来自 visibleChoices）
+        ChoiceOutcome choose(std::size_t choiceIndex);
+
+        // 当前场景的第 choiceIndex 个选项是否可见：REQUIRES 条件满足，且限时选项还没超时
+        bool choiceVisible(std::size_t choiceIndex) const;
+
+        // 限时选项显示的剩余整秒数（向上取整）；已超时或不限时为 0
+        int countdown(std::size_t choiceIndex) const;
+
+        // 推进 dt 秒。只处理到期的计时事件（显示的整秒数变化或超时），
+        // 与选项数无关；有事件发生时返回 true，界面据此重排选项
+        bool advance(float dt);
+
+        // 距离某个可见限时选项显示的整秒数下一次变化（包括超时）还有多少秒；
+        // 没有正在倒计时的可见限时选项时为空，界面可以一直休眠到下一个输入事件
+        std::optional<float> nextDisplayChange() const;
+
+        // 剧情图被热重载（replaceScene）修改后调用：按 ID 重新定位当前场景，属性和 flags 不变。
+        // currentReplaced 为 true 表示当前场景本身被替换：停留在该场景，
+        // 按现有 flags 重新筛选新的选项列表，限时选项重新开始计时
+        void storyChanged(const std::string& currentId, bool currentReplaced);
+
+        // 当前状态的快照（供存档）
+        SaveState snapshot() const;
+
+        // 从快照恢复：进入存档中的场景并还原属性、flags 和限时选项的剩余时间。
+        // 场景已不存在时返回 false，引擎状态不变
+        bool restore(const SaveState& saved);
+
+        const StoryGraph& story() const { return story_; }
+        const GameState& state() const { return state_; }
+        std::uint32_t currentSceneIndex() const { return current_; }
+        const SceneNode& currentScene() const { return story_.scenes[current_]; }
+        ChoiceRange<const Choice> currentChoices() const { return story().choicesOf(current_); }
+
+    private:
+        // 当前场景一个限时选项的计时器，截止时间是会话时钟上的绝对时刻
+        struct Timer {
+            double deadline = 0.0;
+            int    shown    = 0;  // 当前显示的整秒数，0 表示已超时
+        };
+
+        // 计时事件：某个计时器下一次显示变化（最后一次即超时）的时刻
+        struct TimerTick {
+            double        at     = 0.0;
+            std::uint32_t choice = 0;
+        };
+
+        void enterScene(std::uint32_t scene);
+        void startTimer(std::uint32_t choice, float remaining);
+        void pushTick(std::uint32_t choice);
+
+        const StoryGraph& story_;
+        GameState state_;
+        std::uint32_t current_ = NO_SCENE;
+
+        double now_ = 0.0;                // 会话时钟：advance 累计的秒数，单调递增
+        std::vector<Timer> timers_;       // 按当前场景的选项下标，只有限时选项的槽位有效
+        std::vector<TimerTick> ticks_;    // 按 at 排列的最小堆
+    };
+
+} // namespace CampusSim
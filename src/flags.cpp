@@ -0,0 +1,30 @@
+#include "flags.hpp"
+
+namespace CampusSim {
+
+    std::uint32_t FlagTable::intern(const std::string& name) {
+        auto it = ids_.find(name);
+        if (it != ids_.end()) return it->second;
+
+        auto id = static_cast<std::uint32_t>(names_.size());
+        names_.push_back(name);
+        ids_.emplace(name, id);
+        return id;
+    }
+
+    std::uint32_t FlagTable::find(const std::string& name) const {
+        auto it = ids_.find(name);
+        return it == ids_.end() ? NONE : it->second;
+    }
+
+    std::string FlagTable::describe(const FlagSet& flags) const {
+        std::string out;
+        for (std::uint32_t id = 0; id < names_.size(); ++id) {
+            if (!flags.test(id)) continue;
+            if (!out.empty()) out += ", ";
+            out += names_[id];
+        }
+        return out;
+    }
+
+} // namespace CampusSim
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CampusSim {
+
+    // 动态位集：用来存 GameState 的 flags（编译条件时也用它按字攒掩码）
+    class FlagSet {
+    public:
+        void set(std::uint32_t id) {
+            std::size_t w = id / 64;
+            if (w >= words_.size()) words_.resize(w + 1, 0);
+            words_[w] |= std::uint64_t(1) << (id % 64);
+        }
+
+        bool test(std::uint32_t id) const {
+            std::size_t w = id / 64;
+            return w < words_.size() && ((words_[w] >> (id % 64)) & 1u);
+        }
+
+        // mask 中的每一位本集合都有（mask 为空时恒为 true）
+        bool containsAll(const FlagSet& mask) const {
+            for (std::size_t w = 0; w < mask.words_.size(); ++w) {
+                std::uint64_t have = w < words_.size() ? words_[w] : 0;
+                if (mask.words_[w] & ~have) return false;
+            }
+            return true;
+        }
+
+        // 第 w 个 64 位字（超出已分配部分为 0）
+        std::uint64_t word(std::size_t w) const {
+            return w < words_.size() ? words_[w] : 0;
+        }
+
+        bool empty() const {
+            for (auto w : words_) {
+                if (w) return false;
+            }
+            return true;
+        }
+
+        void clear() { words_.clear(); }
+
+        const std::vector<std::uint64_t>& words() const { return words_; }
+
+        friend bool operator==(const FlagSet& a, const FlagSet& b) {
+            const auto& lo = a.words_.size() <= b.words_.size() ? a.words_ : b.words_;
+            const auto& hi = a.words_.size() <= b.words_.size() ? b.words_ : a.words_;
+            for (std::size_t w = 0; w < hi.size(); ++w) {
+                if (hi[w] != (w < lo.size() ? lo[w] : 0)) return false;
+            }
+            return true;
+        }
+        friend bool operator!=(const FlagSet& a, const FlagSet& b) { return !(a == b); }
+
+    private:
+        std::vector<std::uint64_t> words_;
+    };
+
+    // flag 名称 <-> 稠密整数 ID（载入时驻留，调试时可以反查名字）
+    class FlagTable {
+    public:
+        static constexpr std::uint32_t NONE = 0xFFFFFFFFu;
+
+        std::uint32_t intern(const std::string& name);
+
+        // 未出现过的名字返回 NONE
+        std::uint32_t find(const std::string& name) const;
+
+        const std::string& name(std::uint32_t id) const { return names_[id]; }
+        std::size_t size() const { return names_.size(); }
+
+        // 把一组 flag 列成 "a, b, c"，用于日志和调试
+        std::string describe(const FlagSet& flags) const;
+
+    private:
+        std::unordered_map<std::string, std::uint32_t> ids_;
+        std::vector<std::string> names_;
+    };
+
+} // namespace CampusSim
@@ -1,13 +1,35 @@
 #include <SFML/Graphics.hpp>
+
+#include "scene.hpp"
+#include "scene_bundle.hpp"
+#include "asset_archive.hpp"
+#include "story_graph.hpp"
+#include "engine.hpp"
+#include "profiler.hpp"
+#include "replay.hpp"
+#include "save_game.hpp"
+#include "scene_watcher.hpp"
+#include "text_layout.hpp"
+
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <filesystem>
-#include <cctype>
 #include <cmath>
+#include <cstdio>
+#include <list>
+#include <optional>
+#include <deque>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 namespace CampusSim {
 
@@ -15,390 +37,580 @@ namespace CampusSim {
     constexpr float INITIAL_WIDTH  = 1100.f;
     constexpr float INITIAL_HEIGHT = 700.f;
 
-    //上下限
-#ifndef STAT_MAX_VALUE
-    constexpr int STAT_MAX = 100;
-#else
-    constexpr int STAT_MAX = STAT_MAX_VALUE;
-#endif
-    constexpr int STAT_MIN = -100;
-
     // 背景中心微调偏移量：如果觉得画面偏上/偏下/偏左/偏右，可以在这里改
     // 正方向：X 向右为正；Y 向下为正
     constexpr float BG_CENTER_OFFSET_X = 0.f;
     constexpr float BG_CENTER_OFFSET_Y = 0.f;
 
-    // ----------------- 数据结构 -----------------
-
-    struct Stats {
-        int physique        = 0;  // 体质
-        int study           = 0;  // 学力
-        int network         = 0;  // 人脉
-        int reputation      = 0;  // 名誉
-        int experience      = 0;  // 经验
-        int san             = 0;  // 理智
-        int GongnengLecture = 0;  // 公能讲座
-        int volunteer       = 0;  // 志愿服务
-        int socialPractice  = 0;  // 社会实践
-    };
+    // 背景纹理缓存的内存预算（已上传纹理 + 预取中已解码的图片，按 RGBA 字节数计）
+#ifndef BG_CACHE_BUDGET_MB
+    constexpr std::size_t BG_CACHE_BUDGET_BYTES = 256u * 1024u * 1024u;
+#else
+    constexpr std::size_t BG_CACHE_BUDGET_BYTES =
+        static_cast<std::size_t>(BG_CACHE_BUDGET_MB) * 1024u * 1024u;
+#endif
 
-    struct GameState {
-        Stats stats;
-        std::map<std::string, bool> flags;  // 记录关键历史选择
-    };
+    // 界面字号：对话文字，以及选项和属性栏
+    constexpr unsigned int DIALOGUE_TEXT_SIZE = 20;
+    constexpr unsigned int CHOICE_TEXT_SIZE   = 18;
+
+    // ----------------- 文字排版 -----------------
+
+    // 按 (字体, 字号) 缓存字形 advance 和 kerning，换行时不必反复让 sf::Text 重排整行
+    class GlyphMetricsCache {
+    public:
+        // 缓存未命中的次数和耗时：未预热的码点第一次出现时 getGlyph 要现场栅格化，
+        // 这部分就是进入新场景时的排版卡顿
+        struct Counters {
+            std::uint64_t misses        = 0;
+            std::int64_t  missMicros    = 0;
+            std::int64_t  longestMicros = 0;  // 单个字形的最长耗时
+        };
 
-    struct Choice {
-        std::string text;                   // 选项文字（UTF-8）
-        int dPhysique        = 0;           // 体质 变化
-        int dStudy           = 0;           // 学力 变化
-        int dNetwork         = 0;           // 人脉 变化
-        int dReputation      = 0;           // 名誉 变化
-        int dExperience      = 0;           // 经验 变化
-        int dSan             = 0;           // 理智 变化
-        int dGongnengLecture = 0;           // 公能讲座 变化
-        int dVolunteer       = 0;           // 志愿服务 变化
-        int dSocialPractice  = 0;           // 社会实践 变化
-        std::string nextSceneId;            // 下一个场景 ID
-        std::vector<std::string> setFlags;  // 选了这个选项要打的 flag
-        std::vector<std::string> requiredFlags;  // 显示该选项所需为 true 的 flags（全部满足才显示）
-
-        bool  timed          = false;  // 是否为限时选项（FLAGS 中包含 timedXX）
-        float timeLimit      = 0.f;    // 限时总时长（秒）
-        float remainingTime  = 0.f;    // 当前剩余时间（秒）
-    };
+        GlyphMetricsCache(const sf::Font& font, unsigned int characterSize)
+            : font(&font), characterSize(characterSize) {
+            whitespaceWidth = font.getGlyph(U' ', characterSize, false).advance;
+        }
 
-    struct Scene {
-        std::string id;
-        std::string backgroundPath;
-        std::string dialogue;               // 剧情文本（UTF-8，可多行）
-        std::vector<Choice> choices;
-    };
+        unsigned int getCharacterSize() const { return characterSize; }
+        float getWhitespaceWidth() const { return whitespaceWidth; }
+
+        const Counters& getCounters() const { return counters; }
+        void resetCounters() { counters = Counters{}; }
 
-    // ----------------- 工具函数 -----------------
+        const GlyphMetrics& glyph(char32_t ch) {
+            auto it = glyphs.find(ch);
+            if (it != glyphs.end()) return it->second;
 
-    std::string trim(const std::string& s) {
-        std::size_t start = 0;
-        while (start < s.size() &&
-               std::isspace(static_cast<unsigned char>(s[start]))) {
-            ++start;
+            sf::Clock clock;
+            const sf::Glyph& g = font->getGlyph(ch, characterSize, false);
+            std::int64_t us = clock.getElapsedTime().asMicroseconds();
+            ++counters.misses;
+            counters.missMicros += us;
+            counters.longestMicros = std::max(counters.longestMicros, us);
+
+            GlyphMetrics m;
+            m.advance = g.advance;
+            m.left    = g.bounds.position.x;
+            m.right   = g.bounds.position.x + g.bounds.size.x;
+            return glyphs.emplace(ch, m).first->second;
         }
-        std::size_t end = s.size();
-        while (end > start &&
-               std::isspace(static_cast<unsigned char>(s[end - 1]))) {
-            --end;
+
+        float kerning(char32_t prev, char32_t cur) {
+            if (prev == 0 || cur == 0) return 0.f;
+            std::uint64_t key = (static_cast<std::uint64_t>(prev) << 32) | cur;
+            auto it = kernings.find(key);
+            if (it != kernings.end()) return it->second;
+
+            float k = font->getKerning(prev, cur, characterSize, false);
+            kernings.emplace(key, k);
+            return k;
         }
-        return s.substr(start, end - start);
-    }
 
-    bool startsWith(const std::string& s, const std::string& prefix) {
-        return s.rfind(prefix, 0) == 0;
-    }
+    private:
+        const sf::Font* font;
+        unsigned int characterSize;
+        float whitespaceWidth = 0.f;
+        std::unordered_map<char32_t, GlyphMetrics> glyphs;
+        std::unordered_map<std::uint64_t, float> kernings;
+        Counters counters;
+    };
 
-    std::vector<std::string> split(const std::string& s, char delim) {
-        std::vector<std::string> result;
-        std::string current;
-        std::istringstream iss(s);
-        while (std::getline(iss, current, delim)) {
-            result.push_back(trim(current));
+    // 取得某个字体 + 字号对应的度量缓存（字体对象需在整个运行期间保持有效）
+    GlyphMetricsCache& glyphMetricsFor(const sf::Font& font, unsigned int characterSize) {
+        static std::map<std::pair<const sf::Font*, unsigned int>, GlyphMetricsCache> caches;
+        auto key = std::make_pair(&font, characterSize);
+        auto it = caches.find(key);
+        if (it == caches.end()) {
+            it = caches.emplace(key, GlyphMetricsCache(font, characterSize)).first;
         }
-        return result;
+        return it->second;
     }
 
-    // DELTA 字段：例如 "体质=-1,学力=+2" / "physique=-1,study=+2"
-    void parseDelta(const std::string& s, Choice& choice) {
-        if (s.empty()) return;
-        auto items = split(s, ',');
-        for (auto& item : items) {
-            if (item.empty()) continue;
-            auto kv = split(item, '=');
-            if (kv.size() != 2) continue;
-            std::string key = kv[0];
-            int value = 0;
-            try {
-                value = std::stoi(kv[1]);
-            } catch (...) {
-                continue;
-            }
-
-            if (key == "physique" || key == "体质" || key == "P") {
-                choice.dPhysique += value;
-            } else if (key == "study" || key == "学力" || key == "X") {
-                choice.dStudy += value;
-            } else if (key == "network" || key == "人脉" || key == "R") {
-                choice.dNetwork += value;
-            } else if (key == "reputation" || key == "名誉" || key == "M") {
-                choice.dReputation += value;
-            } else if (key == "experience" || key == "经验" || key == "J") {
-                choice.dExperience += value;
-            } else if (key == "san" || key == "理智") {
-                choice.dSan += value;
-            } else if (key == "public" || key == "公能讲座" || key == "G") {
-                choice.dGongnengLecture += value;
-            } else if (key == "volunteer" || key == "志愿服务" || key == "Z") {
-                choice.dVolunteer += value;
-            } else if (key == "social" || key == "社会实践" || key == "S") {
-                choice.dSocialPractice += value;
-            }
-        }
+    // 将一段文本按像素宽度自动换行（基于 sf::String / UTF-32，兼容 SFML 3），
+    // 算法见 text_layout.hpp 的 wrapText，这里只提供 sf::Font 的字形度量
+    sf::String wrapTextToWidth(const sf::String& input,
+                               const sf::Font& font,
+                               unsigned int characterSize,
+                               float maxWidth) {
+        CAMPUS_PROFILE_SCOPE("wrapTextToWidth");
+        GlyphMetricsCache& metrics = glyphMetricsFor(font, characterSize);
+        return sf::String(wrapText(input.getData(), input.getSize(), characterSize, maxWidth, metrics));
+    }
+
+    // 属性栏文字（排版和字形预热共用，预热的码点因此与实际显示的一致）
+    std::string formatStatsText(const Stats& stats) {
+        return "体质: "       + std::to_string(stats.physique) +
+               "   学力: "     + std::to_string(stats.study) +
+               "   人脉: "     + std::to_string(stats.network) +
+               "   名誉: "     + std::to_string(stats.reputation) +
+               "   经验: "     + std::to_string(stats.experience) +
+               "   理智: "     + std::to_string(stats.san) +
+               "\n公能讲座: "  + std::to_string(stats.GongnengLecture) +
+               "   志愿服务: " + std::to_string(stats.volunteer) +
+               "   社会实践: " + std::to_string(stats.socialPractice);
     }
 
-    // FLAGS 字段：例如 "join_union,oversleep,timed10"
-    void parseFlags(const std::string& s, Choice& choice) {
-        if (s.empty()) return;
-        if (s == "0") return;  // 0 作为占位符表示“没有 flags”
-
-        auto items = split(s, ',');
-        for (auto& item : items) {
-            if (item.empty() || item == "0") continue;
-
-            // 特殊语法：timed10 / timed5 / timed30 …… 表示限时选项
-            // 规则：以 "timed" 开头，后面必须是纯数字，才视为限时关键词
-            if (item.rfind("timed", 0) == 0 && item.size() > 5) {
-                try {
-                    int seconds = std::stoi(item.substr(5));
-                    if (seconds > 0) {
-                        choice.timed         = true;
-                        choice.timeLimit     = static_cast<float>(seconds);
-                        choice.remainingTime = choice.timeLimit;
+    // ----------------- 字形预热 -----------------
+
+    // 剧情文字和属性名之外，选项和属性栏还会出现的字符：
+    // 序号和属性值、限时选项的 " (剩余N秒)"、悬停时的箭头 ">"
+    constexpr const char* UI_EXTRA_GLYPHS = "0123456789-()>剩余秒";
+
+    // 启动时把剧情用到的码点按界面字号栅格化进字体的字形页。不预热时每个字第一次出现
+    // 才现场栅格化（字形页满了还要扩大纹理），第一次进入一个场景时会卡一下。
+    // 预热在后台线程进行，与背景图解码等启动工作重叠。sf::Font 不是线程安全的，
+    // 预热期间主线程不能使用这个字体，第一次排版前调用 wait
+    class GlyphPrewarmer {
+    public:
+        struct Job {
+            unsigned int characterSize = 0;
+            std::vector<char32_t> codepoints;  // 排序去重
+        };
+
+        GlyphPrewarmer() = default;
+        ~GlyphPrewarmer() { wait(); }
+
+        GlyphPrewarmer(const GlyphPrewarmer&) = delete;
+        GlyphPrewarmer& operator=(const GlyphPrewarmer&) = delete;
+
+        void start(const sf::Font& font, std::vector<Job> prewarmJobs) {
+            jobs = std::move(prewarmJobs);
+            worker = std::thread([this, &font] {
+                sf::Clock clock;
+                for (const Job& job : jobs) {
+                    // 经由度量缓存取字形：栅格化的同时把换行要用的度量也存好
+                    GlyphMetricsCache& metrics = glyphMetricsFor(font, job.characterSize);
+                    for (char32_t ch : job.codepoints) {
+                        metrics.glyph(ch);
                     }
-                } catch (...) {
-                    // 转数字失败就忽略限时配置，不影响其他 flag
+                    metrics.resetCounters();  // 计数只统计运行中的未命中
                 }
-                continue;  // 不把 timedXX 当成普通 flag 记录
-            }
+                elapsedMicros = clock.getElapsedTime().asMicroseconds();
+            });
+        }
 
-            // 其他全部作为普通 flag 记录
-            choice.setFlags.push_back(item);
+        // 等待预热结束，返回主线程为此阻塞的时间（微秒）；没有在预热时立即返回 0
+        std::int64_t wait() {
+            if (!worker.joinable()) return 0;
+            sf::Clock clock;
+            worker.join();
+            return clock.getElapsedTime().asMicroseconds();
         }
-    }
 
-    // REQUIRES 字段：例如 "research_invite,join_union"
-    void parseRequiredFlags(const std::string& s, Choice& choice) {
-        if (s.empty()) return;
-        if (s == "0") return; // 0 作为占位符时视为“无条件”
-        auto items = split(s, ',');
-        for (auto& item : items) {
-            if (!item.empty() && item != "0") {
-                choice.requiredFlags.push_back(item);
+        // 以下在 wait 之后读取
+        std::size_t glyphCount(unsigned int characterSize) const {
+            for (const Job& job : jobs) {
+                if (job.characterSize == characterSize) return job.codepoints.size();
             }
+            return 0;
         }
-    }
-
-    // 新的选项格式：支持最多5列，最后一列为 REQUIRES
-    void parseChoiceDefinition(const std::string& line, Scene& scene) {
-        if (line.empty()) return;
-
-        auto parts = split(line, '|');
-        if (parts.empty()) return;
-
-        Choice choice;
-
-        // 文本（玩家看到的内容）
-        choice.text = parts[0];
-
-        std::string deltaStr;
-        std::string nextId;
-        std::string flagsStr;
-        std::string requiresStr;
-
-        if (parts.size() == 2) {
-            // 文本 | NEXT
-            nextId = parts[1];
-        } else if (parts.size() == 3) {
-            // 文本 | DELTA | NEXT
-            deltaStr = parts[1];
-            nextId   = parts[2];
-        } else if (parts.size() == 4) {
-            // 文本 | DELTA | NEXT | FLAGS
-            deltaStr = parts[1];
-            nextId   = parts[2];
-            flagsStr = parts[3];
-        } else { // parts.size() >= 5
-            // 文本 | DELTA | NEXT | FLAGS | REQUIRES
-            deltaStr    = parts[1];
-            nextId      = parts[2];
-            flagsStr    = parts[3];
-            requiresStr = parts[4];
-        }
-
-        choice.nextSceneId = trim(nextId);
-        parseDelta(deltaStr, choice);
-        parseFlags(flagsStr, choice);
-        parseRequiredFlags(requiresStr, choice);
-
-        scene.choices.push_back(choice);
-    }
+        std::int64_t getElapsedMicros() const { return elapsedMicros; }
 
-    // 将一段文本按像素宽度自动换行（基于 sf::String / UTF-32，兼容 SFML 3）
-    sf::String wrapTextToWidth(const sf::String& input,
-                               const sf::Font& font,
-                               unsigned int characterSize,
-                               float maxWidth) {
-        sf::Text measure(font, "", characterSize);
+    private:
+        std::vector<Job> jobs;
+        std::int64_t elapsedMicros = 0;
+        std::thread worker;
+    };
 
-        sf::String result;
-        sf::String currentLine;
+    // 按字号收集剧情里的码点：对话文字用对话字号，选项文字、属性栏和界面字符用选项字号
+    std::vector<GlyphPrewarmer::Job> collectStoryGlyphs(const StoryGraph& story) {
+        auto append = [](const std::string& utf8, std::vector<char32_t>& out) {
+            sf::String text = sf::String::fromUtf8(utf8.begin(), utf8.end());
+            collectCodepoints(text.getData(), text.getSize(), out);
+        };
 
-        for (std::size_t i = 0; i < input.getSize(); ++i) {
-            auto ch = input[i];
+        GlyphPrewarmer::Job dialogue;
+        dialogue.characterSize = DIALOGUE_TEXT_SIZE;
+        for (const auto& scene : story.scenes) {
+            append(scene.dialogue, dialogue.codepoints);
+        }
 
-            if (ch == '\n') {
-                result += currentLine;
-                result += '\n';
-                currentLine.clear();
-                continue;
-            }
+        GlyphPrewarmer::Job choices;
+        choices.characterSize = CHOICE_TEXT_SIZE;
+        for (const auto& choice : story.choices) {
+            append(choice.text, choices.codepoints);
+        }
+        append(formatStatsText(Stats{}), choices.codepoints);
+        append(UI_EXTRA_GLYPHS, choices.codepoints);
 
-            sf::String testLine = currentLine;
-            testLine += ch;
+        uniqueCodepoints(dialogue.codepoints);
+        uniqueCodepoints(choices.codepoints);
 
-            measure.setString(testLine);
-            auto bounds = measure.getLocalBounds();
-            float width = bounds.size.x;
+        std::vector<GlyphPrewarmer::Job> jobs;
+        jobs.push_back(std::move(dialogue));
+        jobs.push_back(std::move(choices));
+        return jobs;
+    }
 
-            if (width > maxWidth && !currentLine.isEmpty()) {
-                result += currentLine;
-                result += '\n';
-                currentLine.clear();
-                currentLine += ch;
-            } else {
-                currentLine = testLine;
+    // ----------------- 界面批量绘制 -----------------
+
+    // 把一个字号的所有界面元素（纯色框、文字、下划线）拼进一个 sf::VertexArray，
+    // 一次 draw 画完。纹理是字体该字号的字形页，纯色部分用页左上角保留的白色像素
+    // （纹理坐标 (1, 1)，sf::Text 画下划线也是这么做的）。
+    // 顶点只在布局变化时重建，悬停等效果直接改已有顶点的颜色
+    class TextBatch {
+    public:
+        TextBatch(const sf::Font& font, unsigned int characterSize)
+            : font(&font), characterSize(characterSize), vertices(sf::PrimitiveType::Triangles) {}
+
+        unsigned int getCharacterSize() const { return characterSize; }
+        std::size_t size() const { return vertices.getVertexCount(); }
+        void clear() { vertices.clear(); }
+
+        // 矩形框：填充色 + 向外扩展的描边（与 sf::RectangleShape 一致）
+        void addRect(const sf::RectangleShape& shape) {
+            sf::Vector2f pos  = shape.getPosition();
+            sf::Vector2f size = shape.getSize();
+            float t = shape.getOutlineThickness();
+
+            addSolidQuad(pos.x, pos.y, pos.x + size.x, pos.y + size.y, shape.getFillColor());
+            if (t > 0.f) {
+                sf::Color c = shape.getOutlineColor();
+                addSolidQuad(pos.x - t,          pos.y - t,          pos.x + size.x + t, pos.y,              c);
+                addSolidQuad(pos.x - t,          pos.y + size.y,     pos.x + size.x + t, pos.y + size.y + t, c);
+                addSolidQuad(pos.x - t,          pos.y,              pos.x,              pos.y + size.y,     c);
+                addSolidQuad(pos.x + size.x,     pos.y,              pos.x + size.x + t, pos.y + size.y,     c);
             }
         }
 
-        if (!currentLine.isEmpty()) {
-            result += currentLine;
+        // 按 sf::Text 的排版规则追加字形四边形（位置、颜色取自 text，字号须与本批次相同）
+        void addText(const sf::Text& text) {
+            layoutText(text, true, nullptr);
         }
 
-        return result;
-    }
+        // 只追加 text 每一行的下划线（sf::Text::Underlined 的画法），颜色由调用方指定
+        void addUnderlines(const sf::Text& text, sf::Color color) {
+            layoutText(text, false, &color);
+        }
+
+        // 单个字形，pos 为基线上的笔位
+        void addGlyph(char32_t ch, sf::Vector2f pos, sf::Color color) {
+            const sf::Glyph& g = font->getGlyph(ch, characterSize, false);
+            const float padding = 1.f;  // 与 sf::Text 相同，避免缩放时采样到相邻字形
 
-    // 读取单个 .scene 文件
-    bool loadSceneFile(const std::filesystem::path& path, Scene& scene) {
-        std::ifstream in(path);
-        if (!in) {
-            std::cerr << "无法打开场景文件: " << path << "\n";
-            return false;
+            float left   = pos.x + g.bounds.position.x - padding;
+            float top    = pos.y + g.bounds.position.y - padding;
+            float right  = pos.x + g.bounds.position.x + g.bounds.size.x + padding;
+            float bottom = pos.y + g.bounds.position.y + g.bounds.size.y + padding;
+
+            float u1 = static_cast<float>(g.textureRect.position.x) - padding;
+            float v1 = static_cast<float>(g.textureRect.position.y) - padding;
+            float u2 = static_cast<float>(g.textureRect.position.x + g.textureRect.size.x) + padding;
+            float v2 = static_cast<float>(g.textureRect.position.y + g.textureRect.size.y) + padding;
+
+            addQuad(left, top, right, bottom, color, u1, v1, u2, v2);
         }
 
-        std::string line;
+        // 把 [begin, end) 范围内顶点的颜色改掉（悬停高亮、显示 / 隐藏下划线和箭头）
+        void setColor(std::size_t begin, std::size_t end, sf::Color color) {
+            for (std::size_t i = begin; i < end && i < vertices.getVertexCount(); ++i) {
+                vertices[i].color = color;
+            }
+        }
 
-        // 读 ID
-        while (std::getline(in, line)) {
-            line = trim(line);
-            if (!line.empty()) break;
+        void draw(sf::RenderTarget& target) const {
+            if (vertices.getVertexCount() == 0) return;
+            // 字形页纹理在加载新字形时可能扩容，每次绘制时重新取
+            sf::RenderStates states;
+            states.texture = &font->getTexture(characterSize);
+            target.draw(vertices, states);
         }
-        if (!startsWith(line, "ID:")) {
-            std::cerr << "场景文件缺少 ID: " << path << "\n";
-            return false;
+
+    private:
+        void layoutText(const sf::Text& text, bool glyphs, const sf::Color* underlineColor) {
+            const sf::String& str = text.getString();
+            sf::Vector2f origin = text.getPosition();
+            sf::Color color = text.getFillColor();
+
+            float whitespace = font->getGlyph(U' ', characterSize, false).advance;
+            float lineSpacing = font->getLineSpacing(characterSize);
+            float x = 0.f;
+            float y = static_cast<float>(characterSize);
+            char32_t prev = 0;
+
+            for (std::size_t i = 0; i < str.getSize(); ++i) {
+                char32_t ch = str[i];
+                if (ch == U'\r') continue;
+
+                x += font->getKerning(prev, ch, characterSize, false);
+                if (underlineColor && ch == U'\n' && prev != U'\n') {
+                    addUnderline(origin, x, y, *underlineColor);
+                }
+                prev = ch;
+
+                if (ch == U' ' || ch == U'\t' || ch == U'\n') {
+                    if (ch == U' ') x += whitespace;
+                    else if (ch == U'\t') x += whitespace * 4;
+                    else {
+                        y += lineSpacing;
+                        x = 0.f;
+                    }
+                    continue;
+                }
+
+                if (glyphs) addGlyph(ch, {origin.x + x, origin.y + y}, color);
+                x += font->getGlyph(ch, characterSize, false).advance;
+            }
+            if (underlineColor && x > 0.f) {
+                addUnderline(origin, x, y, *underlineColor);
+            }
         }
-        scene.id = trim(line.substr(3));
 
-        // 读 BG
-        while (std::getline(in, line)) {
-            line = trim(line);
-            if (!line.empty()) break;
+        void addQuad(float left, float top, float right, float bottom, sf::Color color,
+                     float u1, float v1, float u2, float v2) {
+            vertices.append(sf::Vertex{{left,  top},    color, {u1, v1}});
+            vertices.append(sf::Vertex{{right, top},    color, {u2, v1}});
+            vertices.append(sf::Vertex{{left,  bottom}, color, {u1, v2}});
+            vertices.append(sf::Vertex{{left,  bottom}, color, {u1, v2}});
+            vertices.append(sf::Vertex{{right, top},    color, {u2, v1}});
+            vertices.append(sf::Vertex{{right, bottom}, color, {u2, v2}});
         }
-        if (!startsWith(line, "BG:")) {
-            std::cerr << "场景文件缺少 BG: " << path << "\n";
-            return false;
+
+        void addSolidQuad(float left, float top, float right, float bottom, sf::Color color) {
+            addQuad(left, top, right, bottom, color, 1.f, 1.f, 1.f, 1.f);
+        }
+
+        void addUnderline(sf::Vector2f origin, float length, float lineTop, sf::Color color) {
+            float offset    = font->getUnderlinePosition(characterSize);
+            float thickness = font->getUnderlineThickness(characterSize);
+            float top    = std::floor(lineTop + offset - (thickness / 2) + 0.5f);
+            float bottom = top + std::floor(thickness + 0.5f);
+            addSolidQuad(origin.x, origin.y + top, origin.x + length, origin.y + bottom, color);
         }
-        scene.backgroundPath = trim(line.substr(3));
 
-        // 状态机：TEXT 区 + CHOICE 区
-        enum class Section {
-            None,
-            Text,
-            Choice
+        const sf::Font* font;
+        unsigned int characterSize;
+        sf::VertexArray vertices;
+    };
+
+    // ----------------- 背景缓存 -----------------
+
+    // 按 Scene::backgroundPath 缓存背景纹理（LRU 淘汰），
+    // 并用一个后台线程把后继场景的背景预先解码成 sf::Image，切场景时只需上传。
+    // 解码优先从资源包（assetpack 生成，已是 RGBA）解压，不在包里的才解码图片文件
+    class BackgroundCache {
+    public:
+        struct Counters {
+            std::uint64_t hits         = 0;  // 纹理已在缓存中
+            std::uint64_t prefetchHits = 0;  // 纹理不在，但后台已解码好，只需上传
+            std::uint64_t misses       = 0;  // 只能在主线程同步解码
+            std::uint64_t evictions    = 0;  // 因超出预算被淘汰的纹理数
         };
 
-        Section section = Section::None;
-        std::ostringstream dialogueBuf;
+        // archive 可以没有打开（没有资源包时全部读散文件），需在缓存的整个生命期内有效
+        BackgroundCache(std::size_t budgetBytes, const AssetArchive& archive)
+            : budget(budgetBytes), archive(archive), worker([this] { workerLoop(); }) {}
 
-        while (std::getline(in, line)) {
-            std::string t = trim(line);
-            if (t.empty()) {
-                if (section == Section::Text) {
-                    dialogueBuf << "\n";
-                }
-                continue;
+        ~BackgroundCache() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                queue.clear();
             }
+            cv.notify_all();
+            worker.join();
+        }
 
-            if (startsWith(t, "TEXT:")) {
-                section = Section::Text;
-                continue;
+        BackgroundCache(const BackgroundCache&) = delete;
+        BackgroundCache& operator=(const BackgroundCache&) = delete;
+
+        // 取得背景纹理（只能在主线程调用）；加载失败返回 nullptr。
+        // 返回的指针在下一次 acquire 之前保持有效
+        const sf::Texture* acquire(const std::string& path) {
+            auto found = index.find(path);
+            if (found != index.end()) {
+                ++counters.hits;
+                lru.splice(lru.begin(), lru, found->second);
+                return &lru.front().texture;
             }
-            if (startsWith(t, "ENDTEXT")) {
-                section = Section::None;
-                continue;
+            if (failed.count(path)) return nullptr;
+
+            sf::Image image;
+            bool ready = false;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                // 后台正在解码这张图时等它完成，避免重复解码
+                cv.wait(lock, [&] { return decodingPath != path; });
+                auto it = decoded.find(path);
+                if (it != decoded.end()) {
+                    image = std::move(it->second);
+                    decodedBytes -= imageBytes(image);
+                    decoded.erase(it);
+                    ready = true;
+                }
+                queue.erase(std::remove(queue.begin(), queue.end(), path), queue.end());
             }
-            if (startsWith(t, "CHOICE:")) {
-                section = Section::Choice;
-                continue;
+
+            if (ready) {
+                ++counters.prefetchHits;
+            } else {
+                ++counters.misses;
+                if (!decode(path, image)) {
+                    std::cerr << "无法加载背景图 " << path << "\n";
+                    failed.insert(path);
+                    return nullptr;
+                }
             }
-            if (startsWith(t, "ENDCHOICE")) {
-                section = Section::None;
-                continue;
+
+            Entry entry;
+            entry.path  = path;
+            entry.bytes = imageBytes(image);
+            if (!entry.texture.loadFromImage(image)) {
+                std::cerr << "无法上传背景图 " << path << "\n";
+                failed.insert(path);
+                return nullptr;
+            }
+
+            lru.push_front(std::move(entry));
+            index[path] = lru.begin();
+            textureBytes += lru.front().bytes;
+            evictOverBudget();
+            return &lru.front().texture;
+        }
+
+        // 用新的一组后继背景替换预取队列；已缓存、已解码或加载失败过的路径会被跳过，
+        // 不再属于后继集合的已解码图片会被丢弃（包括后台此刻正在解码的那张）
+        void prefetch(const std::vector<std::string>& paths) {
+            std::vector<std::string> wanted;
+            for (const auto& p : paths) {
+                if (p.empty() || index.count(p) || failed.count(p)) continue;
+                if (std::find(wanted.begin(), wanted.end(), p) != wanted.end()) continue;
+                wanted.push_back(p);
             }
 
-            if (section == Section::Text) {
-                if (!dialogueBuf.str().empty() &&
-                    dialogueBuf.str().back() != '\n') {
-                    dialogueBuf << "\n";
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto it = decoded.begin(); it != decoded.end();) {
+                    if (std::find(wanted.begin(), wanted.end(), it->first) == wanted.end()) {
+                        decodedBytes -= imageBytes(it->second);
+                        it = decoded.erase(it);
+                    } else {
+                        ++it;
+                    }
                 }
-                dialogueBuf << t;
-            } else if (section == Section::Choice) {
-                parseChoiceDefinition(t, scene);
-            } else {
-                // 其他内容忽略
+                queue.clear();
+                for (const auto& p : wanted) {
+                    if (!decoded.count(p) && p != decodingPath) {
+                        queue.push_back(p);
+                    }
+                }
+                prefetchPaths = std::move(wanted);
             }
+            cv.notify_all();
         }
 
-        scene.dialogue = dialogueBuf.str();
-        return true;
-    }
+        const Counters& getCounters() const { return counters; }
 
-    // 载入整个 scenes 目录
-    std::map<std::string, Scene> loadScenes(const std::string& dir) {
-        std::map<std::string, Scene> scenes;
-        namespace fs = std::filesystem;
+        // 从资源包解压的次数（含后台预取）
+        std::uint64_t archiveDecodes() const { return archiveLoads.load(std::memory_order_relaxed); }
+
+    private:
+        struct Entry {
+            std::string path;
+            sf::Texture texture;
+            std::size_t bytes = 0;
+        };
 
-        fs::path base(dir);
-        if (!fs::exists(base) || !fs::is_directory(base)) {
-            std::cerr << "场景目录不存在: " << dir << "\n";
-            return scenes;
+        // 解码一张背景：资源包里有（且没有过期）就直接解压像素，否则读图片文件。
+        // 主线程和后台线程都会调用，资源包只读，可以同时解压
+        bool decode(const std::string& path, sf::Image& image) {
+            std::vector<std::uint8_t> pixels;
+            std::uint32_t width = 0;
+            std::uint32_t height = 0;
+            if (archive.load(path, width, height, pixels)) {
+                image.resize(sf::Vector2u{width, height}, pixels.data());
+                archiveLoads.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            return image.loadFromFile(path);
         }
 
-        for (const auto& entry : fs::directory_iterator(base)) {
-            if (!entry.is_regular_file()) continue;
-            if (entry.path().extension() != ".scene") continue;
+        static std::size_t imageBytes(const sf::Image& image) {
+            auto size = image.getSize();
+            return static_cast<std::size_t>(size.x) * size.y * 4u;
+        }
 
-            Scene s;
-            if (loadSceneFile(entry.path(), s)) {
-                scenes[s.id] = std::move(s);
+        // 从最久未使用的一端淘汰，刚放进来的纹理（当前背景）永远保留
+        void evictOverBudget() {
+            while (lru.size() > 1 && textureBytes + pendingBytes() > budget) {
+                Entry& victim = lru.back();
+                textureBytes -= victim.bytes;
+                index.erase(victim.path);
+                lru.pop_back();
+                ++counters.evictions;
             }
         }
 
-        return scenes;
-    }
+        std::size_t pendingBytes() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return decodedBytes;
+        }
 
-    // 根据 flag 对“目标场景 ID”做重定向（你可以自己扩展）
-    std::string resolveSceneId(const std::string& rawId,
-                               const std::map<std::string, bool>& flags) {
-        if (rawId == "dorm_evening") {
-            auto it = flags.find("join_union");
-            if (it != flags.end() && it->second) {
-                return "dorm_evening_after_union";
-            } else {
-                return "dorm_evening_normal";
+        void workerLoop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                cv.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (stopping) return;
+
+                std::string path = std::move(queue.front());
+                queue.pop_front();
+                std::size_t used = decodedBytes + textureBytes.load(std::memory_order_relaxed);
+                decodingPath = path;
+                lock.unlock();
+
+                // 预取的图片和已上传的纹理共用预算，超出时就不再预取
+                sf::Image image;
+                bool ok = used < budget && decode(path, image);
+
+                lock.lock();
+                decodingPath.clear();
+                // 解码期间 prefetch 可能已换了一组后继，不再需要的直接丢掉
+                bool stillWanted =
+                    std::find(prefetchPaths.begin(), prefetchPaths.end(), path) != prefetchPaths.end();
+                if (ok && !stopping && stillWanted) {
+                    decodedBytes += imageBytes(image);
+                    decoded[path] = std::move(image);
+                }
+                cv.notify_all();
             }
         }
-        return rawId;
-    }
+
+        std::size_t budget;
+        const AssetArchive& archive;
+        std::atomic<std::uint64_t> archiveLoads{0};
+        std::atomic<std::size_t> textureBytes{0};  // 只在主线程修改，后台线程读它判断预算
+        std::list<Entry> lru;  // 头部为最近使用
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        std::unordered_set<std::string> failed;  // 加载失败的路径只报一次错
+        Counters counters;
+
+        // 以下成员由 mutex 保护，与后台线程共享
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::string> queue;
+        std::unordered_map<std::string, sf::Image> decoded;
+        std::size_t decodedBytes = 0;
+        std::vector<std::string> prefetchPaths;  // 最近一次 prefetch 要的后继背景
+        std::string decodingPath;
+        bool stopping = false;
+
+        std::thread worker;  // 最后构造，保证线程启动时其他成员都已就绪
+    };
 
     // ----------------- 主逻辑 -----------------
 
-    void run() {
+    // 命令行选项
+    struct RunOptions {
+        bool watchScenes = false;  // --watch：保存 .scene 后热重载，不必重启
+        bool idle        = true;   // 画面没有变化时阻塞等待事件；--no-idle 恢复固定 60 FPS 重画
+        bool resume      = true;   // 启动时读取自动存档继续上次的进度；--new-game 从头开始
+        std::string recordPath;    // --record 文件：录下每帧时间差和每次选择，供复现和回放
+        std::string replayPath;    // --replay 文件：在窗口里按日志回放（不读写自动存档）
+        bool prewarmGlyphs = true; // 启动时在后台预热剧情用到的字形；--no-prewarm 关闭（对比卡顿用）
+    };
+
+    void run(const RunOptions& options) {
         sf::RenderWindow window(
             sf::VideoMode(sf::Vector2u{
                 static_cast<unsigned int>(INITIAL_WIDTH),
@@ -415,73 +627,186 @@ namespace CampusSim {
             return;
         }
 
-        // 载入所有场景
-        auto scenes = loadScenes("scenes");
-        if (scenes.empty()) {
+        // 载入所有场景：优先映射 scenec 生成的剧情包，缺失或过期时回退到逐个解析 .scene。
+        // 两条路径得到的都是链接好的剧情图（flag 已驻留成整数 ID，目标场景已解析成下标）。
+        // 热重载要知道每个场景 ID 保留的是哪个文件，剧情包里没有这个信息，直接解析源文件
+        std::map<std::string, std::filesystem::path> sceneOrigins;
+        StoryGraph story = options.watchScenes
+            ? buildStoryGraph(loadScenes("scenes", 0, &sceneOrigins))
+            : loadStory("scenes");
+        if (story.scenes.empty()) {
             std::cerr << "未加载到任何场景，请检查 scenes 目录。\n";
             return;
         }
 
-        std::string currentSceneId = "start";
-        if (!scenes.count(currentSceneId)) {
+        // 剧情逻辑全部交给引擎，这里只负责显示和输入
+        Engine engine(story);
+        if (!engine.start("start")) {
             std::cerr << "缺少起始场景 ID: start\n";
             return;
         }
-        Scene* currentScene = &scenes[currentSceneId];
 
-        GameState game;  // 属性 + flags
+        // 读取自动存档，直接回到上次的场景
+        const bool replaying = !options.replayPath.empty();
+        if (options.resume && !replaying) {
+            sf::Clock loadClock;
+            SaveState saved;
+            if (loadGame(SAVE_FILE_PATH, saved)) {
+                std::vector<std::size_t> restoredChoices;
+                const bool restored = engine.restore(saved);
+                if (restored) engine.visibleChoices(restoredChoices);
+
+                if (!restored) {
+                    std::cerr << "存档中的场景已不存在: " << saved.sceneId << "，从头开始\n";
+                } else if (restoredChoices.empty()) {
+                    // 存档停在结局（没有可选的选项）。游戏里没有“重新开始”，读它只会卡在结局画面
+                    std::cout << "存档停在结局 " << saved.sceneId << "，从头开始\n";
+                    engine.start("start");
+                } else {
+                    std::cout << "已读取存档: " << saved.sceneId << "（"
+                              << loadClock.getElapsedTime().asMicroseconds() << " 微秒）\n";
+                }
+            }
+        }
+
+        // 回放：从日志记录的初始状态开始，帧时间和选择都取自日志，期间忽略玩家的选择
+        std::vector<std::uint8_t> replayLog;
+        std::optional<ReplayReader> replay;
+        std::uint64_t replayedChoices = 0;
+        if (replaying) {
+            if (!readReplayFile(options.replayPath, replayLog)) return;
+            replay.emplace(replayLog.data(), replayLog.size());
+            if (!replay->ok() || !engine.restore(replay->initial())) {
+                std::cerr << "无法回放 " << options.replayPath << "（日志无效或起始场景不存在）\n";
+                return;
+            }
+            std::cout << "正在回放 " << options.replayPath << "\n";
+        }
+
+        // 字形预热：后台栅格化剧情用到的所有字，与下面的背景图解码等启动工作同时进行
+        GlyphPrewarmer glyphPrewarmer;
+        if (options.prewarmGlyphs) {
+            glyphPrewarmer.start(font, collectStoryGlyphs(story));
+        }
+
+        // 录制：从当前状态（新开局、读档或回放起点）开始
+        ReplayRecorder recorder;
+        if (!options.recordPath.empty() && recorder.open(options.recordPath, engine.snapshot())) {
+            std::cout << "正在录制到 " << options.recordPath << "\n";
+        }
+
+        // 每次选择后自动存档，写盘在后台线程完成（回放时不存，免得覆盖玩家自己的进度）
+        AutoSaver autoSaver(SAVE_FILE_PATH);
 
         // 用于计算每一帧时间差的时钟
         sf::Clock frameClock;
 
-        // 进入一个新场景时，重置该场景所有限时选项的计时器
-        auto resetChoiceTimers = [&]() {
-            if (!currentScene) return;
-            for (auto& ch : currentScene->choices) {
-                if (ch.timed) {
-                    ch.remainingTime = ch.timeLimit;
-                }
-            }
-        };
+        // 背景资源包：assetpack 预先解码、压缩好的背景，没有时全部读图片文件
+        AssetArchive assetArchive;
+        assetArchive.open(ASSET_ARCHIVE_PATH);
+
+        // 背景图（由缓存持有，切换场景时顺便预取后继场景的背景）
+        BackgroundCache backgroundCache(BG_CACHE_BUDGET_BYTES, assetArchive);
+        const sf::Texture* backgroundTexture = nullptr;
+        std::optional<sf::Sprite> backgroundSprite;
+
+        // 背景：强制等比缩放 + 完整显示 + 严格居中（可能留黑边）
+        // 只在换背景或窗口尺寸变化时调用，纹理本身不动
+        auto layoutBackground = [&]() {
+            if (!backgroundSprite) return;
+
+            const sf::View& view = window.getView();
+            sf::Vector2f viewCenter = view.getCenter();
+            sf::Vector2f viewSize = view.getSize();
+            float winW = viewSize.x;
+            float winH = viewSize.y;
+
+            auto texSize = backgroundTexture->getSize();
+            float texW = static_cast<float>(texSize.x);
+            float texH = static_cast<float>(texSize.y);
+            if (texW <= 0.f || texH <= 0.f) return;
+
+            // 将原点设置为纹理中心，方便以中心为基准缩放/居中
+            backgroundSprite->setOrigin(sf::Vector2f{texW * 0.5f, texH * 0.5f});
+
+            // 计算两个缩放比例
+            float scaleX = winW / texW;
+            float scaleY = winH / texH;
+            // 取较小值，保证整张背景图完全显示，不被裁剪（可能留黑边）
+            float scale  = std::min(scaleX, scaleY);
 
-        // 背景图
-        sf::Texture backgroundTexture;
-        bool hasBackground = false;
+            // 设置等比缩放（SFML 3：使用 Vector2f）
+            backgroundSprite->setScale(sf::Vector2f{scale, scale});
+
+            // 直接把 sprite 放在窗口中心，再加上可调偏移量
+            backgroundSprite->setPosition(sf::Vector2f{
+                viewCenter.x + BG_CENTER_OFFSET_X,
+                viewCenter.y + BG_CENTER_OFFSET_Y
+            });
+        };
 
         auto loadBackgroundForCurrentScene = [&]() {
-            hasBackground = false;
-            if (!currentScene->backgroundPath.empty()) {
-                if (backgroundTexture.loadFromFile(currentScene->backgroundPath)) {
-                    hasBackground = true;
-                } else {
-                    std::cerr << "无法加载背景图 " << currentScene->backgroundPath << "\n";
+            CAMPUS_PROFILE_SCOPE("loadBackgroundForCurrentScene");
+            backgroundTexture = nullptr;
+            backgroundSprite.reset();
+            const std::string& bgPath = engine.currentScene().backgroundPath;
+            if (!bgPath.empty()) {
+                backgroundTexture = backgroundCache.acquire(bgPath);
+            }
+            if (backgroundTexture) {
+                backgroundSprite.emplace(*backgroundTexture);
+                layoutBackground();
+            }
+
+            // 按选了该选项之后的属性和 flags 预测重定向的去向
+            std::vector<std::string> successors;
+            for (const auto& ch : engine.currentChoices()) {
+                GameState after = engine.state();
+                applyDelta(after.stats, ch);
+                for (auto f : ch.setFlagIds) after.flags.set(f);
+                std::uint32_t next = resolveNextScene(story, ch, after.stats, after.flags);
+                if (next != NO_SCENE) {
+                    successors.push_back(story.scenes[next].backgroundPath);
                 }
             }
+            backgroundCache.prefetch(successors);
         };
 
         loadBackgroundForCurrentScene();
-        resetChoiceTimers();
+
+        // 热重载：只重新解析保存过的文件，替换进剧情图，玩家的属性、flags 和当前场景保持不变
+        std::optional<SceneWatcher> sceneWatcher;
+        if (options.watchScenes) {
+            sceneWatcher.emplace();
+            if (sceneWatcher->start("scenes")) {
+                std::cout << "正在监视 scenes 目录，保存后自动重新载入\n";
+            } else {
+                sceneWatcher.reset();
+            }
+        }
 
         // 对话框背景
         sf::RectangleShape dialogBox;
         dialogBox.setFillColor(sf::Color(0, 0, 150, 230));  // 更明显的深蓝色，方便观察
 
         // 对话文字
-        sf::Text dialogueText(font, "", 20);
+        sf::Text dialogueText(font, "", DIALOGUE_TEXT_SIZE);
         dialogueText.setFillColor(sf::Color::White);
 
         // 选项文字（最多 8 个）
+        const sf::Color choiceColor(230, 230, 210);
+        const sf::Color choiceHoverColor(255, 255, 200);
         std::vector<sf::Text> choiceTexts;
         choiceTexts.reserve(8);
         for (int i = 0; i < 8; ++i) {
-            sf::Text t(font, "", 18);
-            t.setFillColor(sf::Color(230, 230, 210));
+            sf::Text t(font, "", CHOICE_TEXT_SIZE);
+            t.setFillColor(choiceColor);
             choiceTexts.push_back(t);
         }
         std::vector<std::size_t> visibleChoiceIndices;
 
         // 属性显示（左上角）
-        sf::Text statsText(font, "", 18);
+        sf::Text statsText(font, "", CHOICE_TEXT_SIZE);
         statsText.setFillColor(sf::Color::Yellow);
 
         // 属性栏背景框（左上角）
@@ -490,17 +815,73 @@ namespace CampusSim {
         statsBox.setOutlineColor(sf::Color(255, 255, 255, 220));
         statsBox.setOutlineThickness(3.f);
 
-        // UI 更新函数：根据当前窗口大小重新布局
+        // 上面这些框和文字只用来排版、测量和命中检测，实际绘制走两个顶点批次：
+        // 字号 20 的对话框 + 对话文字，字号 18 的选项 + 属性栏（各自对应字体的一张字形页纹理）
+        TextBatch dialogueBatch(font, dialogueText.getCharacterSize());
+        TextBatch choiceBatch(font, choiceTexts[0].getCharacterSize());
+
+        // 每个可见选项在 choiceBatch 中的顶点区间：正文，以及只在悬停时显示的下划线和 ">" 箭头
+        struct ChoiceVertices {
+            std::size_t textBegin  = 0;
+            std::size_t textEnd    = 0;
+            std::size_t hoverBegin = 0;
+            std::size_t hoverEnd   = 0;
+        };
+        std::vector<ChoiceVertices> choiceVertices;
+        bool batchDirty = true;  // 布局变化后才重建顶点
+        int batchHovered = -1;   // 顶点颜色目前对应的悬停项
+
+        // 布局失效标记：每一部分只在它依赖的输入变化时才重算
+        enum LayoutPart : unsigned {
+            LayoutDialogue = 1u << 0,  // 对话换行：窗口大小、当前场景
+            LayoutChoices  = 1u << 1,  // 可见选项 + 选项换行：窗口大小、场景、flags、限时秒数
+            LayoutStats    = 1u << 2,  // 属性栏文字：属性值
+            LayoutAll      = LayoutDialogue | LayoutChoices | LayoutStats
+        };
+        unsigned layoutDirty = LayoutAll;
+
+        // 布局计数：用来确认空闲帧没有做任何布局工作
+        struct LayoutCounters {
+            std::uint64_t frames   = 0;  // 总帧数（主循环迭代次数）
+            std::uint64_t draws    = 0;  // 实际重画的次数
+            std::uint64_t passes   = 0;  // 实际执行的布局次数
+            std::uint64_t dialogue = 0;  // 其中重排对话的次数
+            std::uint64_t choices  = 0;  // 其中重排选项的次数
+            std::uint64_t stats    = 0;  // 其中重建属性栏的次数
+            std::int64_t  glyphStallMicros = 0;  // 单次布局中现场栅格化字形的最长耗时
+        };
+        LayoutCounters layoutCounters;
+
+        // 两个界面字号累计现场栅格化字形的耗时（只在字形预热结束后调用）
+        auto glyphMissMicros = [&]() {
+            return glyphMetricsFor(font, DIALOGUE_TEXT_SIZE).getCounters().missMicros +
+                   glyphMetricsFor(font, CHOICE_TEXT_SIZE).getCounters().missMicros;
+        };
+
+        // 上一次布局的结果（未失效的部分直接复用）
+        sf::Vector2f layoutViewSize{0.f, 0.f};
+        float dlgHeight = 0.f;
+        std::vector<float> choiceHeights(choiceTexts.size(), 0.f);
+
+        // UI 更新函数：根据当前窗口大小和失效标记重新布局
         auto updateUI = [&]() {
             // 用当前视图尺寸做布局，避免 HiDPI 或视图缩放导致的坐标偏移
             const sf::View& view = window.getView();
             sf::Vector2f viewSize = view.getSize();
+            if (viewSize != layoutViewSize) {
+                // 尺寸变化但没有收到 Resized 事件时也能兜底
+                layoutViewSize = viewSize;
+                layoutDirty |= LayoutAll;
+            }
+            if (layoutDirty == 0) return;
+
+            CAMPUS_PROFILE_SCOPE("updateUI");
             float winW = viewSize.x;
             float winH = viewSize.y;
             if (winW <= 0.f || winH <= 0.f) return;
 
-            const std::string& d = currentScene->dialogue;
-            sf::String dlg = sf::String::fromUtf8(d.begin(), d.end());
+            ++layoutCounters.passes;
+            std::int64_t missMicrosBefore = glyphMissMicros();
 
             float dialogPaddingLeft   = 40.f;
             float dialogPaddingRight  = 40.f;
@@ -513,76 +894,65 @@ namespace CampusSim {
             if (dialogWidth < 200.f) dialogWidth = 200.f;
             float dialogMaxWidth = dialogWidth - 40.f;
 
-            sf::String wrappedDlg = wrapTextToWidth(
-                dlg,
-                font,
-                dialogueText.getCharacterSize(),
-                dialogMaxWidth
-            );
-            dialogueText.setString(wrappedDlg);
-            auto dlgBounds = dialogueText.getLocalBounds();
-            float dlgHeight = dlgBounds.size.y;
-
-            // 1) 计算可见选项
-            visibleChoiceIndices.clear();
-            for (std::size_t i = 0; i < currentScene->choices.size(); ++i) {
-                const Choice& ch = currentScene->choices[i];
-                bool visible = true;
-
-                // REQUIRES：所有 requiredFlags 必须为 true
-                for (const auto& rf : ch.requiredFlags) {
-                    auto it = game.flags.find(rf);
-                    if (it == game.flags.end() || !it->second) {
-                        visible = false;
-                        break;
-                    }
-                }
+            // 1) 对话文本换行
+            if (layoutDirty & LayoutDialogue) {
+                ++layoutCounters.dialogue;
+
+                const std::string& d = engine.currentScene().dialogue;
+                sf::String dlg = sf::String::fromUtf8(d.begin(), d.end());
+                sf::String wrappedDlg = wrapTextToWidth(
+                    dlg,
+                    font,
+                    dialogueText.getCharacterSize(),
+                    dialogMaxWidth
+                );
+                dialogueText.setString(wrappedDlg);
+                auto dlgBounds = dialogueText.getLocalBounds();
+                dlgHeight = dlgBounds.size.y;
+            }
 
-                // 限时选项：时间耗尽就不再显示
-                if (visible && ch.timed && ch.remainingTime <= 0.f) {
-                    visible = false;
-                }
+            // 2) 计算可见选项，准备选项文本并测高度
+            if (layoutDirty & LayoutChoices) {
+                ++layoutCounters.choices;
 
-                if (visible) {
-                    visibleChoiceIndices.push_back(i);
-                }
-            }
+                // REQUIRES 全部满足、限时未耗尽的选项才显示
+                engine.visibleChoices(visibleChoiceIndices);
+                auto choices = engine.currentChoices();
 
-            // 2) 准备选项文本并测高度
-            std::vector<float> choiceHeights(choiceTexts.size(), 0.f);
-            float totalChoiceHeight = 0.f;
+                for (std::size_t i = 0; i < choiceTexts.size(); ++i) {
+                    if (i < visibleChoiceIndices.size()) {
+                        const auto& ch = choices[visibleChoiceIndices[i]];
+                        std::string lineUtf8 = std::to_string(i + 1) + ") " + ch.text;
 
-            for (std::size_t i = 0; i < choiceTexts.size(); ++i) {
-                if (i < visibleChoiceIndices.size()) {
-                    const auto& ch = currentScene->choices[visibleChoiceIndices[i]];
-                    std::string lineUtf8 = std::to_string(i + 1) + ") " + ch.text;
-
-                    // 限时选项追加剩余时间（向上取整）
-                    if (ch.timed && ch.remainingTime > 0.f) {
-                        int seconds = static_cast<int>(std::ceil(ch.remainingTime));
-                        if (seconds < 0) seconds = 0;
-                        lineUtf8 += " (剩余" + std::to_string(seconds) + "秒)";
-                    }
+                        // 限时选项追加剩余时间（向上取整）
+                        int secondsLeft = engine.countdown(visibleChoiceIndices[i]);
+                        if (ch.timed && secondsLeft > 0) {
+                            lineUtf8 += " (剩余" + std::to_string(secondsLeft) + "秒)";
+                        }
 
-                    sf::String line = sf::String::fromUtf8(lineUtf8.begin(), lineUtf8.end());
-                    float choiceMaxWidth = dialogMaxWidth - 40.f;
-                    sf::String wrappedLine = wrapTextToWidth(
-                        line,
-                        font,
-                        choiceTexts[i].getCharacterSize(),
-                        choiceMaxWidth
-                    );
-                    choiceTexts[i].setString(wrappedLine);
-
-                    auto cb = choiceTexts[i].getLocalBounds();
-                    float h = cb.size.y;
-                    choiceHeights[i] = h;
-                    totalChoiceHeight += h + choiceLineSpacing;
-                } else {
-                    choiceTexts[i].setString("");
-                    choiceHeights[i] = 0.f;
+                        sf::String line = sf::String::fromUtf8(lineUtf8.begin(), lineUtf8.end());
+                        float choiceMaxWidth = dialogMaxWidth - 40.f;
+                        sf::String wrappedLine = wrapTextToWidth(
+                            line,
+                            font,
+                            choiceTexts[i].getCharacterSize(),
+                            choiceMaxWidth
+                        );
+                        choiceTexts[i].setString(wrappedLine);
+
+                        auto cb = choiceTexts[i].getLocalBounds();
+                        choiceHeights[i] = cb.size.y;
+                    } else {
+                        choiceTexts[i].setString("");
+                        choiceHeights[i] = 0.f;
+                    }
                 }
             }
+
+            float totalChoiceHeight = 0.f;
+            for (std::size_t i = 0; i < choiceTexts.size() && i < visibleChoiceIndices.size(); ++i) {
+                totalChoiceHeight += choiceHeights[i] + choiceLineSpacing;
+            }
             if (totalChoiceHeight > 0.f) {
                 totalChoiceHeight -= choiceLineSpacing;
             }
@@ -624,23 +994,69 @@ namespace CampusSim {
             }
 
             // 4) 属性栏文字和背景
-            std::string statsStr =
-                "体质: "       + std::to_string(game.stats.physique) +
-                "   学力: "     + std::to_string(game.stats.study) +
-                "   人脉: "     + std::to_string(game.stats.network) +
-                "   名誉: "     + std::to_string(game.stats.reputation) +
-                "   经验: "     + std::to_string(game.stats.experience) +
-                "   理智: "     + std::to_string(game.stats.san) +
-                "\n公能讲座: "  + std::to_string(game.stats.GongnengLecture) +
-                "   志愿服务: " + std::to_string(game.stats.volunteer) +
-                "   社会实践: " + std::to_string(game.stats.socialPractice);
-
-            statsText.setString(sf::String::fromUtf8(statsStr.begin(), statsStr.end()));
+            if (layoutDirty & LayoutStats) {
+                ++layoutCounters.stats;
+
+                std::string statsStr = formatStatsText(engine.state().stats);
+                statsText.setString(sf::String::fromUtf8(statsStr.begin(), statsStr.end()));
+            }
             statsText.setPosition(sf::Vector2f{30.f, 40.f});
 
             statsBox.setPosition(sf::Vector2f{20.f, 20.f});
             statsBox.setSize({winW - 40.f, 70.f});
 
+            layoutCounters.glyphStallMicros =
+                std::max(layoutCounters.glyphStallMicros, glyphMissMicros() - missMicrosBefore);
+            layoutDirty = 0;
+            batchDirty = true;
+        };
+
+        // 按当前布局重建两个顶点批次（悬停效果全部复位）
+        auto rebuildBatches = [&]() {
+            CAMPUS_PROFILE_SCOPE("rebuildBatches");
+
+            dialogueBatch.clear();
+            dialogueBatch.addRect(dialogBox);
+            dialogueBatch.addText(dialogueText);
+
+            choiceBatch.clear();
+            choiceVertices.clear();
+            for (std::size_t i = 0; i < visibleChoiceIndices.size() && i < choiceTexts.size(); ++i) {
+                const sf::Text& text = choiceTexts[i];
+                ChoiceVertices range;
+                range.textBegin = choiceBatch.size();
+                choiceBatch.addText(text);
+                range.textEnd = range.hoverBegin = choiceBatch.size();
+
+                choiceBatch.addUnderlines(text, sf::Color::Transparent);
+                choiceBatch.addGlyph(U'>', sf::Vector2f{
+                    text.getPosition().x - 20.f,
+                    text.getPosition().y + static_cast<float>(text.getCharacterSize())
+                }, sf::Color::Transparent);
+                range.hoverEnd = choiceBatch.size();
+                choiceVertices.push_back(range);
+            }
+
+            choiceBatch.addRect(statsBox);
+            choiceBatch.addText(statsText);
+
+            batchHovered = -1;
+            batchDirty = false;
+        };
+
+        // 悬停项变化时只改相关顶点的颜色：正文变亮，下划线和箭头从透明变为可见
+        auto applyHover = [&](int hovered) {
+            if (hovered == batchHovered) return;
+            auto paint = [&](int index, bool on) {
+                if (index < 0 || static_cast<std::size_t>(index) >= choiceVertices.size()) return;
+                const ChoiceVertices& range = choiceVertices[index];
+                choiceBatch.setColor(range.textBegin, range.textEnd, on ? choiceHoverColor : choiceColor);
+                choiceBatch.setColor(range.hoverBegin, range.hoverEnd,
+                                     on ? choiceHoverColor : sf::Color::Transparent);
+            };
+            paint(batchHovered, false);
+            paint(hovered, true);
+            batchHovered = hovered;
         };
 
         // 统一的选项命中检测
@@ -653,242 +1069,408 @@ namespace CampusSim {
             return bounds.contains(worldPos);
         };
 
+        // 排版要用字体，先等字形预热结束（通常早已在背景图解码期间完成）
+        std::int64_t prewarmWaitMicros = glyphPrewarmer.wait();
+        if (options.prewarmGlyphs) {
+            std::cout << "字形预热: " << glyphPrewarmer.glyphCount(DIALOGUE_TEXT_SIZE) << " + "
+                      << glyphPrewarmer.glyphCount(CHOICE_TEXT_SIZE) << " 个字形（后台 "
+                      << glyphPrewarmer.getElapsedMicros() << " 微秒，首次排版前等待 "
+                      << prewarmWaitMicros << " 微秒）\n";
+        }
+
         // 先更新一次界面
         updateUI();
 
+#ifdef CAMPUS_PROFILE
+        // 性能浮层（F3 开关，F4 把 Chrome trace 写到 PROFILE_TRACE_PATH）
+        const char* PROFILE_TRACE_PATH = "campus_trace.json";
+        bool profileOverlay = false;
+        sf::Text profileText(font, "", 14);
+        profileText.setFillColor(sf::Color(180, 255, 180));
+        sf::RectangleShape profileBox;
+        profileBox.setFillColor(sf::Color(0, 0, 0, 200));
+
+        // 浮层文字每隔几帧刷新一次，画在属性栏下方右侧
+        auto updateProfileOverlay = [&]() {
+            const Profiler& profiler = Profiler::instance();
+            char line[128];
+            std::snprintf(line, sizeof(line), "frame p50 %.2f ms  p99 %.2f ms  (%zu)\n",
+                          profiler.frameMillis(0.50), profiler.frameMillis(0.99), profiler.frameSamples());
+            std::string text = line;
+            // 按嵌套层数缩进；子阶段先结束，所以倒序后再按开始时间排一次
+            std::vector<Profiler::Event> phases = profiler.lastFrame();
+            std::sort(phases.begin(), phases.end(), [](const Profiler::Event& a, const Profiler::Event& b) {
+                return a.startUs != b.startUs ? a.startUs < b.startUs : a.depth < b.depth;
+            });
+            for (const auto& e : phases) {
+                if (e.depth == 0) continue;
+                std::snprintf(line, sizeof(line), "%*s%-30s %7.3f ms\n", int(e.depth - 1) * 2, "",
+                              e.name, static_cast<double>(e.durationUs) / 1000.0);
+                text += line;
+            }
+            profileText.setString(text);
+
+            sf::Vector2f boxPos = statsBox.getPosition();
+            sf::Vector2f boxSize = statsBox.getSize();
+            auto bounds = profileText.getLocalBounds();
+            float x = boxPos.x + boxSize.x - bounds.size.x - 20.f;
+            float y = boxPos.y + boxSize.y + 10.f;
+            profileBox.setPosition({x - 10.f, y});
+            profileBox.setSize({bounds.size.x + 20.f, bounds.position.y + bounds.size.y + 10.f});
+            profileText.setPosition({x, y + 5.f});
+        };
+#endif
+
         int hoveredIndex = -1;  // 当前鼠标悬停的选项索引，-1 表示没有
 
+        // 是否需要重画：布局、悬停、背景、窗口尺寸等任何可见变化都会置位，画完清零。
+        // 为 false 时主循环阻塞在 waitEvent 上，不占 CPU
+        bool needsRedraw = true;
+
         // 主循环
         while (window.isOpen()) {
-            // 本帧时间差（秒）
+            // 空闲等待：有正在倒计时的限时选项时，最多等到它显示的整秒数变化；
+            // 热重载开启时还要定期醒来检查文件。等待期间收到的第一个事件留给下面的事件循环处理
+            std::optional<sf::Event> wokenBy;
+            float plannedWait = 0.f;
+            if (options.idle && !needsRedraw && !replay) {
+                std::optional<float> wait = engine.nextDisplayChange();
+                if (sceneWatcher) {
+                    float pollEvery = SCENE_WATCH_DEBOUNCE / 1000.f;
+                    wait = wait ? std::min(*wait, pollEvery) : pollEvery;
+                }
+
+                if (!wait) {
+                    wokenBy = window.waitEvent();  // 无超时：一直睡到下一个输入事件
+                } else if (*wait > 0.f) {
+                    plannedWait = *wait;
+                    // 多等 1 毫秒，保证醒来时秒数确实已经变化
+                    wokenBy = window.waitEvent(sf::seconds(*wait + 0.001f));
+                }
+            }
+
+            CAMPUS_PROFILE_FRAME_BEGIN();
+            ++layoutCounters.frames;
+
+            // 本帧时间差（秒）。卡顿时最多按 0.5 秒推进，主动休眠的时间则要完整计入倒计时
             float dt = frameClock.restart().asSeconds();
             if (dt < 0.f) dt = 0.f;
-            if (dt > 0.5f) dt = 0.5f;
-
-            // 更新限时选项的剩余时间
-            for (auto& ch : currentScene->choices) {
-                if (ch.timed && ch.remainingTime > 0.f) {
-                    ch.remainingTime -= dt;
-                    if (ch.remainingTime < 0.f) {
-                        ch.remainingTime = 0.f;
+            dt = std::min(dt, std::max(0.5f, plannedWait + 0.1f));
+
+            // 回放时用日志里的帧时间；录制时记下量化后的 dt，引擎也用量化后的值，保证回放逐位一致
+            if (replay) {
+                ReplayEvent frameEvent;
+                if (replay->next(frameEvent) && frameEvent.kind == ReplayRecord::Frame) {
+                    dt = frameEvent.dt;
+                } else {
+                    if (replay->ok()) {
+                        std::cout << "回放结束：" << replayedChoices << " 次选择全部一致，之后可以手动继续\n";
+                    } else {
+                        std::cerr << "回放日志在第 " << replayedChoices + 1 << " 次选择附近损坏，之后可以手动继续\n";
                     }
+                    replay.reset();
                 }
             }
+            if (recorder.isOpen()) {
+                dt = recorder.frame(dt);
+            }
 
-            // 先处理事件（包括窗口大小变化）
-            int chosenIndex = -1;
-
-            while (true) {
-                auto event = window.pollEvent();
-                if (!event) {
-                    break;
+            // 更新限时选项的剩余时间（显示的整秒数变化时才需要重排选项）
+            {
+                CAMPUS_PROFILE_SCOPE("tickTimers");
+                if (engine.advance(dt)) {
+                    layoutDirty |= LayoutChoices;
                 }
+            }
 
-                // 窗口大小改变：更新视图和布局
-                if (event->is<sf::Event::Resized>()) {
-                    const auto* rs = event->getIf<sf::Event::Resized>();
-                    if (rs) {
-                        // 保持“世界坐标 == 像素坐标”，防止窗口缩放后视图仍用旧尺寸导致居中偏移
-                        sf::View view(sf::FloatRect(
-                            sf::Vector2f{0.f, 0.f},
-                            sf::Vector2f{
-                                static_cast<float>(rs->size.x),
-                                static_cast<float>(rs->size.y)
-                            }
-                        ));
-                        sf::Vector2f viewSize = view.getSize();
-                        view.setCenter(sf::Vector2f{
-                            viewSize.x * 0.5f,
-                            viewSize.y * 0.5f
-                        });
-                        window.setView(view);
+            // 先处理事件（包括窗口大小变化）
+            int chosenIndex = -1;
+            bool resized = false;  // 一批 Resized 事件只做一次重排
+
+            {
+                CAMPUS_PROFILE_SCOPE("pollEvents");
+                while (true) {
+                    std::optional<sf::Event> event = wokenBy ? std::move(wokenBy) : window.pollEvent();
+                    wokenBy.reset();
+                    if (!event) {
+                        break;
+                    }
 
-                        loadBackgroundForCurrentScene();
-                        updateUI();
+                    // 窗口重新获得焦点时补画一次（部分平台切回窗口后内容需要刷新）
+                    if (event->is<sf::Event::FocusGained>()) {
+                        needsRedraw = true;
                     }
-                }
 
-                if (event->is<sf::Event::Closed>()) {
-                    window.close();
-                }
+                    // 窗口大小改变：更新视图和布局
+                    if (event->is<sf::Event::Resized>()) {
+                        const auto* rs = event->getIf<sf::Event::Resized>();
+                        if (rs) {
+                            // 保持“世界坐标 == 像素坐标”，防止窗口缩放后视图仍用旧尺寸导致居中偏移
+                            sf::View view(sf::FloatRect(
+                                sf::Vector2f{0.f, 0.f},
+                                sf::Vector2f{
+                                    static_cast<float>(rs->size.x),
+                                    static_cast<float>(rs->size.y)
+                                }
+                            ));
+                            sf::Vector2f viewSize = view.getSize();
+                            view.setCenter(sf::Vector2f{
+                                viewSize.x * 0.5f,
+                                viewSize.y * 0.5f
+                            });
+                            window.setView(view);
+                            resized = true;
+                        }
+                    }
 
-                if (event->is<sf::Event::KeyPressed>()) {
-                    const auto* key = event->getIf<sf::Event::KeyPressed>();
-                    switch (key->code) {
-                        case sf::Keyboard::Key::Num1: chosenIndex = 0; break;
-                        case sf::Keyboard::Key::Num2: chosenIndex = 1; break;
-                        case sf::Keyboard::Key::Num3: chosenIndex = 2; break;
-                        case sf::Keyboard::Key::Num4: chosenIndex = 3; break;
-                        case sf::Keyboard::Key::Num5: chosenIndex = 4; break;
-                        case sf::Keyboard::Key::Num6: chosenIndex = 5; break;
-                        case sf::Keyboard::Key::Num7: chosenIndex = 6; break;
-                        case sf::Keyboard::Key::Num8: chosenIndex = 7; break;
-                        default: break;
+                    if (event->is<sf::Event::Closed>()) {
+                        window.close();
                     }
-                }
 
-                // 鼠标左键点击选项
-                if (event->is<sf::Event::MouseButtonPressed>()) {
-                    const auto* mb = event->getIf<sf::Event::MouseButtonPressed>();
-                    if (mb && mb->button == sf::Mouse::Button::Left) {
-                        sf::Vector2f worldPos = window.mapPixelToCoords(mb->position);
-                        for (std::size_t i = 0; i < visibleChoiceIndices.size(); ++i) {
-                            if (hitTestChoice(i, worldPos)) {
-                                chosenIndex = static_cast<int>(i);
+                    if (event->is<sf::Event::KeyPressed>()) {
+                        const auto* key = event->getIf<sf::Event::KeyPressed>();
+                        switch (key->code) {
+                            case sf::Keyboard::Key::Num1: chosenIndex = 0; break;
+                            case sf::Keyboard::Key::Num2: chosenIndex = 1; break;
+                            case sf::Keyboard::Key::Num3: chosenIndex = 2; break;
+                            case sf::Keyboard::Key::Num4: chosenIndex = 3; break;
+                            case sf::Keyboard::Key::Num5: chosenIndex = 4; break;
+                            case sf::Keyboard::Key::Num6: chosenIndex = 5; break;
+                            case sf::Keyboard::Key::Num7: chosenIndex = 6; break;
+                            case sf::Keyboard::Key::Num8: chosenIndex = 7; break;
+#ifdef CAMPUS_PROFILE
+                            case sf::Keyboard::Key::F3:
+                                profileOverlay = !profileOverlay;
+                                if (profileOverlay) updateProfileOverlay();
+                                needsRedraw = true;
+                                break;
+                            case sf::Keyboard::Key::F4:
+                                if (Profiler::instance().writeChromeTrace(PROFILE_TRACE_PATH)) {
+                                    std::cout << "性能记录已写入 " << PROFILE_TRACE_PATH << "\n";
+                                }
                                 break;
+#endif
+                            default: break;
+                        }
+                    }
+
+                    // 鼠标左键点击选项
+                    if (event->is<sf::Event::MouseButtonPressed>()) {
+                        const auto* mb = event->getIf<sf::Event::MouseButtonPressed>();
+                        if (mb && mb->button == sf::Mouse::Button::Left) {
+                            sf::Vector2f worldPos = window.mapPixelToCoords(mb->position);
+                            for (std::size_t i = 0; i < visibleChoiceIndices.size(); ++i) {
+                                if (hitTestChoice(i, worldPos)) {
+                                    chosenIndex = static_cast<int>(i);
+                                    break;
+                                }
                             }
                         }
                     }
-                }
 
-                // 鼠标移动：更新悬停项
-                if (event->is<sf::Event::MouseMoved>()) {
-                    const auto* mv = event->getIf<sf::Event::MouseMoved>();
-                    if (mv) {
-                        sf::Vector2f worldPos = window.mapPixelToCoords(mv->position);
-                        hoveredIndex = -1;
-                        for (std::size_t i = 0; i < visibleChoiceIndices.size(); ++i) {
-                            if (hitTestChoice(i, worldPos)) {
-                                hoveredIndex = static_cast<int>(i);
-                                break;
+                    // 鼠标移动：更新悬停项
+                    if (event->is<sf::Event::MouseMoved>()) {
+                        const auto* mv = event->getIf<sf::Event::MouseMoved>();
+                        if (mv) {
+                            sf::Vector2f worldPos = window.mapPixelToCoords(mv->position);
+                            hoveredIndex = -1;
+                            for (std::size_t i = 0; i < visibleChoiceIndices.size(); ++i) {
+                                if (hitTestChoice(i, worldPos)) {
+                                    hoveredIndex = static_cast<int>(i);
+                                    break;
+                                }
                             }
                         }
                     }
                 }
             }
 
-            // 然后根据最新窗口大小再更新一遍 UI（防止尺寸变化但没有事件时）
-            updateUI();
+            // 保存过的场景文件：重新解析并替换。当前场景被改时停留在原地，
+            // 按现有 flags 重新筛选新选项（限时选项重新计时），背景和整个界面重排
+            if (sceneWatcher) {
+                for (const auto& path : sceneWatcher->poll()) {
+                    Scene scene;
+                    if (!loadSceneFile(path, scene)) continue;
+
+                    // 与载入时的规则一致：重复的 ID 只认路径靠前的那份，其它副本的保存不生效
+                    auto [origin, isNew] = sceneOrigins.emplace(scene.id, path);
+                    if (!isNew && origin->second != path) {
+                        std::cerr << "重复的场景 ID " << scene.id << ": " << path.string()
+                                  << "（保留 " << origin->second.string() << "），未重新载入\n";
+                        continue;
+                    }
+
+                    const std::string currentId = engine.currentScene().id;
+                    const bool currentReplaced = scene.id == currentId;
+                    replaceScene(story, std::move(scene));
+                    engine.storyChanged(currentId, currentReplaced);
+                    std::cout << "已重新载入 " << path.string() << "\n";
 
-            // 处理选项
-            if (chosenIndex >= 0 &&
-                static_cast<std::size_t>(chosenIndex) < visibleChoiceIndices.size()) {
-
-                const Choice& choice = currentScene->choices[visibleChoiceIndices[chosenIndex]];
-
-                // 1. 改属性
-                game.stats.physique        += choice.dPhysique;
-                game.stats.study           += choice.dStudy;
-                game.stats.network         += choice.dNetwork;
-                game.stats.reputation      += choice.dReputation;
-                game.stats.experience      += choice.dExperience;
-                game.stats.GongnengLecture += choice.dGongnengLecture;
-                game.stats.volunteer       += choice.dVolunteer;
-                game.stats.socialPractice  += choice.dSocialPractice;
-
-                auto clamp = [](int v) {
-                    if (v < STAT_MIN) return STAT_MIN;
-                    if (v > STAT_MAX) return STAT_MAX;
-                    return v;
-                };
-                game.stats.physique        = clamp(game.stats.physique);
-                game.stats.study           = clamp(game.stats.study);
-                game.stats.network         = clamp(game.stats.network);
-                game.stats.reputation      = clamp(game.stats.reputation);
-                game.stats.experience      = clamp(game.stats.experience);
-                game.stats.san             = clamp(game.stats.san);
-                game.stats.GongnengLecture = clamp(game.stats.GongnengLecture);
-                game.stats.volunteer       = clamp(game.stats.volunteer);
-                game.stats.socialPractice  = clamp(game.stats.socialPractice);
-
-                // 2. 记录 flags
-                for (const auto& f : choice.setFlags) {
-                    game.flags[f] = true;
+                    if (currentReplaced) {
+                        loadBackgroundForCurrentScene();
+                        hoveredIndex = -1;
+                        layoutDirty |= LayoutAll;
+                    }
                 }
+            }
 
-                // 3. 计算真正要去的场景 ID（根据 flags 做分支）
-                std::string targetId =
-                    resolveSceneId(choice.nextSceneId, game.flags);
+            // 拖动窗口边缘会连续产生很多 Resized 事件，这里合并成一次：
+            // 只重算背景精灵的变换并让布局失效，纹理保持不变
+            if (resized) {
+                layoutBackground();
+                layoutDirty |= LayoutAll;
+                needsRedraw = true;
+            }
 
-                auto it = scenes.find(targetId);
-                if (it != scenes.end()) {
-                    currentSceneId = targetId;
-                    currentScene   = &it->second;
-                    loadBackgroundForCurrentScene();
-                    resetChoiceTimers();
-                    hoveredIndex = -1;
-                    updateUI();
+            // 然后按失效标记更新 UI（没有任何输入变化时不做布局）
+            updateUI();
+
+            // 处理选项：玩家选的可见选项，或者回放日志里紧跟在这一帧之后的选择
+            if (replay ? replay->choiceNext()
+                       : chosenIndex >= 0 &&
+                         static_cast<std::size_t>(chosenIndex) < visibleChoiceIndices.size()) {
+                CAMPUS_PROFILE_SCOPE("choose");
+
+                const std::string fromScene = engine.currentScene().id;
+                std::size_t choiceIndex = 0;
+                Engine::ChoiceOutcome outcome;
+                if (replay) {
+                    ReplayEvent choiceEvent;
+                    replay->next(choiceEvent);
+                    choiceIndex = choiceEvent.choice;
+                    std::string error;
+                    if (applyReplayChoice(engine, choiceEvent, outcome, error)) {
+                        ++replayedChoices;
+                    } else {
+                        std::cerr << "回放第 " << replayedChoices + 1 << " 次选择时不一致: " << error
+                                  << "，停在这里\n";
+                        replay.reset();
+                    }
                 } else {
-                    std::cerr << "找不到场景: " << targetId << "\n";
+                    choiceIndex = visibleChoiceIndices[chosenIndex];
+                    outcome = engine.choose(choiceIndex);
                 }
-            }
 
-            // 绘制
-            window.clear(sf::Color(20, 20, 40));
-
-            // 1) 背景：强制等比缩放 + 完整显示 + 严格居中（可能留黑边）
-            if (hasBackground) {
-                const sf::View& view = window.getView();
-                sf::Vector2f viewCenter = view.getCenter();
-                sf::Vector2f viewSize = view.getSize();
-                float winW = viewSize.x;
-                float winH = viewSize.y;
-
-                sf::Sprite bg(backgroundTexture);
-                auto texSize = backgroundTexture.getSize();
-                float texW = static_cast<float>(texSize.x);
-                float texH = static_cast<float>(texSize.y);
-
-                if (texW > 0.f && texH > 0.f) {
-                    // 将原点设置为纹理中心，方便以中心为基准缩放/居中
-                    bg.setOrigin(sf::Vector2f{texW * 0.5f, texH * 0.5f});
-
-                    // 计算两个缩放比例
-                    float scaleX = winW / texW;
-                    float scaleY = winH / texH;
-                    // 取较小值，保证整张背景图完全显示，不被裁剪（可能留黑边）
-                    float scale  = std::min(scaleX, scaleY);
-
-                    // 设置等比缩放（SFML 3：使用 Vector2f）
-                    bg.setScale(sf::Vector2f{scale, scale});
-
-                    // 直接把 sprite 放在窗口中心，再加上可调偏移量
-                    bg.setPosition(sf::Vector2f{
-                        viewCenter.x + BG_CENTER_OFFSET_X,
-                        viewCenter.y + BG_CENTER_OFFSET_Y
-                    });
+                if (outcome.applied) {
+                    layoutDirty |= LayoutStats;
+                    if (!replaying) autoSaver.submit(engine.snapshot());
+                    recorder.choice(static_cast<std::uint32_t>(choiceIndex), fromScene, engine);
+                }
+                if (outcome.flagsChanged) {
+                    layoutDirty |= LayoutChoices;
+                }
+                if (outcome.sceneChanged) {
+                    loadBackgroundForCurrentScene();
+                    hoveredIndex = -1;
+                    layoutDirty |= LayoutAll;
                 }
 
-                window.draw(bg);
+                // 本帧就重排，空闲模式下不会再有“下一帧”来补
+                updateUI();
             }
 
-            // 2) 对话框 + 文本 + 选项
-            window.draw(dialogBox);
-            window.draw(dialogueText);
+            // 重画判断：布局重算过或悬停项变了才需要重画
+            if (batchDirty || hoveredIndex != batchHovered) {
+                needsRedraw = true;
+            }
+#ifdef CAMPUS_PROFILE
+            if (profileOverlay) {
+                needsRedraw = true;  // 浮层显示时持续刷新
+            }
+#endif
+            if (!options.idle) {
+                needsRedraw = true;
+            }
 
-            for (std::size_t i = 0; i < visibleChoiceIndices.size(); ++i) {
-                if (static_cast<int>(i) == hoveredIndex) {
-                    // 悬停选项：变亮、加下划线，并在前面加一个小箭头 ">"
-                    choiceTexts[i].setFillColor(sf::Color(255, 255, 200));
-                    choiceTexts[i].setStyle(sf::Text::Underlined);
+            // 绘制
+            if (needsRedraw) {
+                {
+                    CAMPUS_PROFILE_SCOPE("draw");
+                    window.clear(sf::Color(20, 20, 40));
+
+                    // 1) 背景
+                    if (backgroundSprite) {
+                        window.draw(*backgroundSprite);
+                    }
 
-                    sf::Text arrow(font, ">", choiceTexts[i].getCharacterSize());
-                    arrow.setFillColor(sf::Color(255, 255, 200));
-                    arrow.setPosition(sf::Vector2f{
-                        choiceTexts[i].getPosition().x - 20.f,
-                        choiceTexts[i].getPosition().y
-                    });
-                    window.draw(arrow);
-                } else {
-                    choiceTexts[i].setFillColor(sf::Color(230, 230, 210));
-                    choiceTexts[i].setStyle(sf::Text::Regular);
+                    // 2) 对话框 + 对话文字，选项 + 属性栏：两个顶点批次各一次 draw。
+                    // 悬停选项变亮、显示下划线和前面的小箭头 ">"，只改顶点颜色
+                    if (batchDirty) {
+                        rebuildBatches();
+                    }
+                    applyHover(hoveredIndex);
+                    dialogueBatch.draw(window);
+                    choiceBatch.draw(window);
+
+#ifdef CAMPUS_PROFILE
+                    // 3) 性能浮层（上一帧的数据，每 15 帧刷新一次文字）
+                    if (profileOverlay) {
+                        if (layoutCounters.frames % 15 == 1) updateProfileOverlay();
+                        window.draw(profileBox);
+                        window.draw(profileText);
+                    }
+#endif
                 }
 
-                window.draw(choiceTexts[i]);
+                window.display();
+                ++layoutCounters.draws;
+                needsRedraw = false;
             }
-
-            // 3) 属性栏
-            window.draw(statsBox);
-            window.draw(statsText);
-
-            window.display();
+            CAMPUS_PROFILE_FRAME_END();
         }
+
+        // 退出时再存一次，保留限时选项已经流逝的时间（autoSaver 析构时等它写完）
+        if (!replaying) autoSaver.submit(engine.snapshot());
+
+        std::cout << "布局统计: " << layoutCounters.frames << " 帧（重画 " << layoutCounters.draws << " 次）, "
+                  << layoutCounters.passes << " 次布局（对话 " << layoutCounters.dialogue
+                  << " / 选项 " << layoutCounters.choices
+                  << " / 属性 " << layoutCounters.stats << "）\n";
+
+        // 与 --no-prewarm 的输出对比，就是预热省掉的排版卡顿
+        const auto& dialogueGlyphs = glyphMetricsFor(font, DIALOGUE_TEXT_SIZE).getCounters();
+        const auto& choiceGlyphs = glyphMetricsFor(font, CHOICE_TEXT_SIZE).getCounters();
+        std::cout << "现场栅格化字形: " << dialogueGlyphs.misses + choiceGlyphs.misses << " 个，共 "
+                  << dialogueGlyphs.missMicros + choiceGlyphs.missMicros << " 微秒（单字最长 "
+                  << std::max(dialogueGlyphs.longestMicros, choiceGlyphs.longestMicros)
+                  << " 微秒，单次布局最长 " << layoutCounters.glyphStallMicros << " 微秒）\n";
+
+        const auto& bgCounters = backgroundCache.getCounters();
+        std::cout << "背景缓存: 命中 " << bgCounters.hits
+                  << ", 预取命中 " << bgCounters.prefetchHits
+                  << ", 未命中 " << bgCounters.misses
+                  << ", 淘汰 " << bgCounters.evictions
+                  << "（从资源包解压 " << backgroundCache.archiveDecodes() << " 次）\n";
+        std::cout << "已记录 flags: " << story.flags.describe(engine.state().flags) << "\n";
     }
 
 } // namespace CampusSim
 
-int main() {
+int main(int argc, char** argv) {
     std::cout << "这是最新版本CampusSim" << std::endl;
-    CampusSim::run();
+
+    CampusSim::RunOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--watch") {
+            options.watchScenes = true;
+        } else if (arg == "--no-idle") {
+            options.idle = false;
+        } else if (arg == "--no-prewarm") {
+            options.prewarmGlyphs = false;
+        } else if (arg == "--new-game") {
+            options.resume = false;
+        } else if (arg == "--record" && i + 1 < argc) {
+            options.recordPath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            options.replayPath = argv[++i];
+        } else {
+            std::cerr << "未知参数: " << arg << "\n用法: CampusSim [--watch] [--no-idle] [--no-prewarm] [--new-game]"
+                         " [--record 文件] [--replay 文件]\n";
+            return 2;
+        }
+    }
+
+    CampusSim::run(options);
     return 0;
 }
@@ -0,0 +1,122 @@
+#include "mapped_file.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace CampusSim {
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+#ifdef _WIN32
+            std::swap(fileHandle_, other.fileHandle_);
+            std::swap(mappingHandle_, other.mappingHandle_);
+#endif
+        }
+        return *this;
+    }
+
+#ifdef _WIN32
+
+    bool MappedFile::open(const std::filesystem::path& path) {
+        close();
+
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        fileHandle_    = file;
+        mappingHandle_ = mapping;
+        data_ = static_cast<const std::uint8_t*>(view);
+        size_ = static_cast<std::size_t>(fileSize.QuadPart);
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (data_) UnmapViewOfFile(data_);
+        if (mappingHandle_) CloseHandle(static_cast<HANDLE>(mappingHandle_));
+        if (fileHandle_) CloseHandle(static_cast<HANDLE>(fileHandle_));
+        data_ = nullptr;
+        size_ = 0;
+        fileHandle_    = nullptr;
+        mappingHandle_ = nullptr;
+    }
+
+#else
+
+    bool MappedFile::open(const std::filesystem::path& path) {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* view = ::mmap(nullptr, static_cast<std::size_t>(st.st_size),
+                            PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);  // 映射建立后即可关闭文件描述符
+        if (view == MAP_FAILED) return false;
+
+        data_ = static_cast<const std::uint8_t*>(view);
+        size_ = static_cast<std::size_t>(st.st_size);
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (data_) {
+            ::munmap(const_cast<std::uint8_t*>(data_), size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+#endif
+
+} // namespace CampusSim
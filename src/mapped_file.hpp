@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace CampusSim {
+
+    // 只读内存映射文件（POSIX 用 mmap，Windows 用 CreateFileMapping）
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        // 映射整个文件；文件不存在或为空时返回 false
+        bool open(const std::filesystem::path& path);
+        void close();
+
+        bool isOpen() const { return data_ != nullptr; }
+        const std::uint8_t* data() const { return data_; }
+        std::size_t size() const { return size_; }
+
+    private:
+        const std::uint8_t* data_ = nullptr;
+        std::size_t size_ = 0;
+#ifdef _WIN32
+        void* fileHandle_    = nullptr;
+        void* mappingHandle_ = nullptr;
+#endif
+    };
+
+} // namespace CampusSim
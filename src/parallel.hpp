@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace CampusSim {
+
+    // 默认工作线程数：硬件并发数（取不到时为 1）
+    inline unsigned defaultThreadCount() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n == 0 ? 1u : n;
+    }
+
+    // 把 [0, count) 分给若干线程执行 fn(i)，用原子计数器动态领取任务，全部完成后返回。
+    // threadCount 为 0 时使用 defaultThreadCount()；fn 必须可以并发调用
+    template <typename Fn>
+    void parallelFor(std::size_t count, unsigned threadCount, Fn&& fn) {
+        if (count == 0) return;
+        if (threadCount == 0) threadCount = defaultThreadCount();
+        std::size_t workers = std::min<std::size_t>(threadCount, count);
+
+        std::atomic<std::size_t> next{0};
+        auto work = [&]() {
+            for (std::size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                fn(i);
+            }
+        };
+
+        if (workers <= 1) {
+            work();
+            return;
+        }
+
+        std::vector<std::thread> pool;
+        pool.reserve(workers - 1);
+        for (std::size_t t = 1; t < workers; ++t) {
+            pool.emplace_back(work);
+        }
+        work();  // 当前线程也参与
+        for (auto& th : pool) th.join();
+    }
+
+} // namespace CampusSim
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <charconv>
+#include <string_view>
+#include <system_error>
+
+// 不抛异常的数值解析，命令行参数（cli_args.hpp）和会话服务的协议共用
+
+namespace CampusSim {
+
+    // 整个 text 是一个合法的、在 T 范围内的数时写入 out 并返回 true，否则 out 不变。
+    // 不接受前后空白、正号和多余的字符；无符号类型不接受负数
+    template <typename T>
+    bool parseNumber(std::string_view text, T& out) {
+        const char* first = text.data();
+        const char* last  = first + text.size();
+        T value{};
+        auto [end, ec] = std::from_chars(first, last, value);
+        if (ec != std::errc() || end != last || text.empty()) return false;
+        out = value;
+        return true;
+    }
+
+} // namespace CampusSim
@@ -0,0 +1,110 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+namespace CampusSim {
+
+    namespace {
+
+        std::uint64_t steadyMicros() {
+            using namespace std::chrono;
+            return static_cast<std::uint64_t>(
+                duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+        }
+
+        void writeJsonString(std::ostream& out, const char* s) {
+            out << '"';
+            for (; *s; ++s) {
+                if (*s == '"' || *s == '\\') out << '\\';
+                out << *s;
+            }
+            out << '"';
+        }
+
+    } // namespace
+
+    Profiler& Profiler::instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    Profiler::Profiler()
+        : origin_(steadyMicros()),
+          frameMs_(PROFILE_FRAME_WINDOW, 0.f) {
+        trace_.reserve(1024);
+    }
+
+    std::uint64_t Profiler::nowUs() const {
+        return steadyMicros() - origin_;
+    }
+
+    void Profiler::beginFrame() {
+        currentFrame_.clear();
+        depth_ = 0;
+        frameStart_ = nowUs();
+    }
+
+    void Profiler::endFrame() {
+        std::uint64_t end = nowUs();
+        Event frame{"frame", frameStart_, end - frameStart_, 0};
+        currentFrame_.push_back(frame);
+        record(frame);
+
+        frameMs_[frameCount_ % PROFILE_FRAME_WINDOW] = static_cast<float>(frame.durationUs) / 1000.f;
+        ++frameCount_;
+        lastFrame_.swap(currentFrame_);
+    }
+
+    void Profiler::leave(const char* name, std::uint64_t startUs, std::uint32_t depth) {
+        Event e{name, startUs, nowUs() - startUs, depth};
+        depth_ = depth - 1;
+        currentFrame_.push_back(e);
+        record(e);
+    }
+
+    void Profiler::record(const Event& e) {
+        if (trace_.size() < PROFILE_TRACE_CAPACITY) {
+            trace_.push_back(e);
+            return;
+        }
+        trace_[traceNext_] = e;
+        traceNext_ = (traceNext_ + 1) % PROFILE_TRACE_CAPACITY;
+        traceWrapped_ = true;
+    }
+
+    double Profiler::frameMillis(double p) const {
+        std::size_t n = frameSamples();
+        if (n == 0) return 0.0;
+
+        std::vector<float> sorted(frameMs_.begin(), frameMs_.begin() + n);
+        std::size_t k = std::min(n - 1, static_cast<std::size_t>(p * static_cast<double>(n)));
+        std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+        return sorted[k];
+    }
+
+    bool Profiler::writeChromeTrace(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "无法写入性能记录: " << path << "\n";
+            return false;
+        }
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        // 环形缓冲写满后从最旧的一条开始输出
+        std::size_t first = traceWrapped_ ? traceNext_ : 0;
+        for (std::size_t i = 0; i < trace_.size(); ++i) {
+            const Event& e = trace_[(first + i) % trace_.size()];
+            if (i) out << ",\n";
+            out << "{\"name\":";
+            writeJsonString(out, e.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << e.startUs
+                << ",\"dur\":" << e.durationUs << "}";
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+} // namespace CampusSim
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 主循环分阶段计时。编译时定义 CAMPUS_PROFILE（CMake 选项 CAMPUSSIM_PROFILE）才启用，
+// 否则 CAMPUS_PROFILE_SCOPE / CAMPUS_PROFILE_FRAME_BEGIN / CAMPUS_PROFILE_FRAME_END 展开为空，不产生任何代码。
+// 只在主线程使用
+
+namespace CampusSim {
+
+    // 滚动统计的帧数
+#ifndef PROFILE_WINDOW_FRAMES
+    constexpr std::size_t PROFILE_FRAME_WINDOW = 240;
+#else
+    constexpr std::size_t PROFILE_FRAME_WINDOW = PROFILE_WINDOW_FRAMES;
+#endif
+
+    // Chrome trace 最多保留的事件数（环形缓冲，满了覆盖最旧的）
+#ifndef PROFILE_TRACE_EVENTS
+    constexpr std::size_t PROFILE_TRACE_CAPACITY = 200000;
+#else
+    constexpr std::size_t PROFILE_TRACE_CAPACITY = PROFILE_TRACE_EVENTS;
+#endif
+
+    class Profiler {
+    public:
+        // 一段计时：name 必须是字符串字面量（只存指针）
+        struct Event {
+            const char*   name;
+            std::uint64_t startUs;     // 相对 Profiler 创建时刻
+            std::uint64_t durationUs;
+            std::uint32_t depth;       // 嵌套层数，帧本身为 0
+        };
+
+        static Profiler& instance();
+
+        std::uint64_t nowUs() const;
+
+        void beginFrame();
+        void endFrame();
+
+        // 由 ProfileScope 调用：enter 返回当前嵌套层数
+        std::uint32_t enter() { return ++depth_; }
+        void leave(const char* name, std::uint64_t startUs, std::uint32_t depth);
+
+        // 最近 PROFILE_FRAME_WINDOW 帧的帧时间分位数（毫秒），p 在 0~1 之间
+        double frameMillis(double p) const;
+        std::size_t frameSamples() const { return frameCount_ < PROFILE_FRAME_WINDOW ? frameCount_ : PROFILE_FRAME_WINDOW; }
+
+        // 上一帧的所有计时段（按结束顺序）
+        const std::vector<Event>& lastFrame() const { return lastFrame_; }
+
+        // 把保留的事件写成 Chrome trace-event JSON（chrome://tracing、Perfetto 可直接打开）
+        bool writeChromeTrace(const std::string& path) const;
+
+    private:
+        Profiler();
+
+        void record(const Event& e);
+
+        std::uint64_t origin_;
+        std::uint32_t depth_ = 0;
+        std::uint64_t frameStart_ = 0;
+
+        std::vector<Event> currentFrame_;
+        std::vector<Event> lastFrame_;
+
+        std::vector<float> frameMs_;  // 环形
+        std::size_t frameCount_ = 0;
+
+        std::vector<Event> trace_;    // 环形
+        std::size_t traceNext_ = 0;
+        bool traceWrapped_ = false;
+    };
+
+    // 作用域计时：构造时开始，析构时记录
+    class ProfileScope {
+    public:
+        explicit ProfileScope(const char* name)
+            : name_(name),
+              depth_(Profiler::instance().enter()),
+              start_(Profiler::instance().nowUs()) {}
+        ~ProfileScope() { Profiler::instance().leave(name_, start_, depth_); }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        const char* name_;
+        std::uint32_t depth_;
+        std::uint64_t start_;
+    };
+
+} // namespace CampusSim
+
+#ifdef CAMPUS_PROFILE
+#define CAMPUS_PROFILE_CONCAT_(a, b) a##b
+#define CAMPUS_PROFILE_CONCAT(a, b) CAMPUS_PROFILE_CONCAT_(a, b)
+#define CAMPUS_PROFILE_SCOPE(name) \
+    ::CampusSim::ProfileScope CAMPUS_PROFILE_CONCAT(campusProfileScope_, __LINE__)(name)
+#define CAMPUS_PROFILE_FRAME_BEGIN() ::CampusSim::Profiler::instance().beginFrame()
+#define CAMPUS_PROFILE_FRAME_END() ::CampusSim::Profiler::instance().endFrame()
+#else
+#define CAMPUS_PROFILE_SCOPE(name) ((void)0)
+#define CAMPUS_PROFILE_FRAME_BEGIN() ((void)0)
+#define CAMPUS_PROFILE_FRAME_END() ((void)0)
+#endif
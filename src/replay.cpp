@@ -0,0 +1,266 @@
+#include "replay.hpp"
+#include "byte_io.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+namespace CampusSim {
+
+    namespace {
+
+        constexpr char REPLAY_MAGIC[4] = {'C', 'S', 'R', 'P'};
+
+        // 文件写出阈值：攒够这么多帧记录也写一次，长时间不做选择时内存不会一直涨
+        constexpr std::size_t REPLAY_FLUSH_BYTES = 64 * 1024;
+
+        // 录制和回放共用同一个换算，保证量化后的 dt 完全相同
+        float dtFromMicros(std::uint64_t us) {
+            return static_cast<float>(static_cast<double>(us) / 1e6);
+        }
+
+    } // namespace
+
+    std::uint32_t replayFlagHash(const Engine& engine) {
+        const FlagTable& table = engine.story().flags;
+        const FlagSet& flags = engine.state().flags;
+
+        std::uint32_t h = 2166136261u;  // 32 位 FNV-1a
+        for (std::uint32_t id = 0; id < table.size(); ++id) {
+            if (!flags.test(id)) continue;
+            for (unsigned char c : table.name(id)) {
+                h ^= c;
+                h *= 16777619u;
+            }
+            h *= 16777619u;  // 相当于再哈希一个 '\0'，把相邻的名字分开
+        }
+        return h;
+    }
+
+    // ----------------- 录制 -----------------
+
+    bool ReplayRecorder::open(const std::filesystem::path& path, const SaveState& initial) {
+        close();
+        out_.open(path, std::ios::binary | std::ios::trunc);
+        if (!out_) {
+            std::cerr << "无法写入回放日志: " << path << "\n";
+            return false;
+        }
+        toFile_ = true;
+        writeHeader(initial);
+        flushToFile();
+        return true;
+    }
+
+    void ReplayRecorder::openInMemory(const SaveState& initial) {
+        close();
+        toFile_ = false;
+        buffer_.clear();
+        writeHeader(initial);
+    }
+
+    void ReplayRecorder::writeHeader(const SaveState& initial) {
+        std::vector<std::uint8_t> state;
+        encodeSave(initial, state);
+
+        ByteWriter w(buffer_);
+        w.bytes(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+        w.varint(REPLAY_FORMAT_VERSION);
+        w.varint(state.size());
+        w.bytes(state.data(), state.size());
+        recording_ = true;
+    }
+
+    float ReplayRecorder::frame(float dt) {
+        auto us = static_cast<std::uint64_t>(std::llround(std::max(dt, 0.f) * 1e6));
+        if (recording_) {
+            ByteWriter w(buffer_);
+            w.u8(static_cast<std::uint8_t>(ReplayRecord::Frame));
+            w.varint(us);
+            if (toFile_ && buffer_.size() >= REPLAY_FLUSH_BYTES) flushToFile();
+        }
+        return dtFromMicros(us);
+    }
+
+    void ReplayRecorder::choice(std::uint32_t choiceIndex, const std::string& fromSceneId, const Engine& engine) {
+        if (!recording_) return;
+
+        ByteWriter w(buffer_);
+        w.u8(static_cast<std::uint8_t>(ReplayRecord::Choice));
+        w.varint(choiceIndex);
+        w.str(fromSceneId);
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            w.svarint(engine.state().stats.*STAT_FIELDS[k]);
+        }
+        w.u32le(replayFlagHash(engine));
+
+        if (toFile_) flushToFile();
+    }
+
+    void ReplayRecorder::flushToFile() {
+        if (!toFile_ || buffer_.empty()) return;
+        out_.write(reinterpret_cast<const char*>(buffer_.data()),
+                   static_cast<std::streamsize>(buffer_.size()));
+        out_.flush();
+        buffer_.clear();
+    }
+
+    void ReplayRecorder::close() {
+        if (recording_ && toFile_) {
+            flushToFile();
+            out_.close();
+        }
+        recording_ = false;
+    }
+
+    std::vector<std::uint8_t> ReplayRecorder::take() {
+        recording_ = false;
+        return std::move(buffer_);
+    }
+
+    // ----------------- 读取 -----------------
+
+    ReplayReader::ReplayReader(const std::uint8_t* data, std::size_t size)
+        : p_(data), end_(data + size) {
+        if (size < sizeof(REPLAY_MAGIC) || std::memcmp(data, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0) {
+            p_ = end_;
+            return;
+        }
+
+        ByteReader r(data + sizeof(REPLAY_MAGIC), size - sizeof(REPLAY_MAGIC));
+        if (r.varint() != REPLAY_FORMAT_VERSION) {
+            p_ = end_;
+            return;
+        }
+        std::uint64_t stateSize = r.varint();
+        const std::uint8_t* state = r.ok() && stateSize <= r.remaining()
+            ? r.skip(static_cast<std::size_t>(stateSize))
+            : nullptr;
+        if (!state || !decodeSave(state, static_cast<std::size_t>(stateSize), initial_)) {
+            p_ = end_;
+            return;
+        }
+
+        p_ = r.position();
+        ok_ = true;
+    }
+
+    bool ReplayReader::choiceNext() const {
+        return ok_ && p_ != end_ && *p_ == static_cast<std::uint8_t>(ReplayRecord::Choice);
+    }
+
+    bool ReplayReader::next(ReplayEvent& event) {
+        if (!ok_ || p_ == end_) return false;
+
+        ByteReader r(p_, static_cast<std::size_t>(end_ - p_));
+        auto kind = static_cast<ReplayRecord>(r.u8());
+        event.kind = kind;
+        if (kind == ReplayRecord::Frame) {
+            event.dt = dtFromMicros(r.varint());
+        } else if (kind == ReplayRecord::Choice) {
+            event.choice  = static_cast<std::uint32_t>(r.varint());
+            event.sceneId = r.strView();
+            for (int k = 0; k < STAT_COUNT; ++k) {
+                event.stats.*STAT_FIELDS[k] = static_cast<int>(r.svarint());
+            }
+            event.flagHash = r.u32le();
+        } else {
+            ok_ = false;
+            return false;
+        }
+
+        if (!r.ok()) {
+            // 录制中途崩溃时最后一条记录可能不完整，丢掉即可
+            p_ = end_;
+            return false;
+        }
+        p_ = r.position();
+        return true;
+    }
+
+    bool readReplayFile(const std::filesystem::path& path, std::vector<std::uint8_t>& out) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::cerr << "无法打开回放日志: " << path << "\n";
+            return false;
+        }
+        out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    // ----------------- 回放 -----------------
+
+    bool applyReplayChoice(Engine& engine, const ReplayEvent& event,
+                           Engine::ChoiceOutcome& outcome, std::string& error) {
+        if (engine.currentScene().id != event.sceneId) {
+            error = "应在场景 " + std::string(event.sceneId) + "，实际在 " + engine.currentScene().id;
+            return false;
+        }
+        auto choices = engine.currentChoices();
+        if (event.choice >= choices.size() ||
+            !engine.choiceVisible(event.choice)) {
+            error = "场景 " + engine.currentScene().id + " 的选项 " + std::to_string(event.choice) + " 不可选";
+            return false;
+        }
+
+        outcome = engine.choose(event.choice);
+
+        const Stats& stats = engine.state().stats;
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            int expected = event.stats.*STAT_FIELDS[k];
+            int actual   = stats.*STAT_FIELDS[k];
+            if (expected != actual) {
+                error = std::string(STAT_NAMES[k]) + " 应为 " + std::to_string(expected) +
+                        "，实际为 " + std::to_string(actual);
+                return false;
+            }
+        }
+        if (replayFlagHash(engine) != event.flagHash) {
+            error = "flags 不一致（实际: " + engine.story().flags.describe(engine.state().flags) + "）";
+            return false;
+        }
+        return true;
+    }
+
+    ReplayResult replaySession(const StoryGraph& story, const std::uint8_t* data, std::size_t size) {
+        ReplayResult result;
+        ReplayReader reader(data, size);
+        if (!reader.ok()) {
+            result.ok = false;
+            result.error = "不是有效的回放日志";
+            return result;
+        }
+
+        Engine engine(story);
+        if (!engine.restore(reader.initial())) {
+            result.ok = false;
+            result.error = "起始场景不存在: " + reader.initial().sceneId;
+            return result;
+        }
+
+        ReplayEvent event;
+        Engine::ChoiceOutcome outcome;
+        while (reader.next(event)) {
+            if (event.kind == ReplayRecord::Frame) {
+                engine.advance(event.dt);
+                ++result.frames;
+                continue;
+            }
+
+            if (!applyReplayChoice(engine, event, outcome, result.error)) {
+                result.ok = false;
+                result.error = "第 " + std::to_string(result.choices + 1) + " 次选择: " + result.error;
+                return result;
+            }
+            ++result.choices;
+        }
+        if (!reader.ok()) {
+            result.ok = false;
+            result.error = "日志在第 " + std::to_string(result.choices + 1) + " 次选择附近损坏";
+        }
+        return result;
+    }
+
+} // namespace CampusSim
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "engine.hpp"
+#include "save_game.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CampusSim {
+
+    // 回放日志格式版本：格式变化时递增
+    constexpr std::uint32_t REPLAY_FORMAT_VERSION = 1;
+
+    // 回放日志：
+    //   "CSRP" 版本(varint) 初始状态(str，encodeSave 的结果)
+    //   记录…（直到文件结束；录制中途崩溃时截断的日志也能回放到截断处）
+    //     帧：   0 dt(varint 微秒)
+    //     选择： 1 场景内选项下标(varint) 所在场景 ID(str)
+    //            选择后的九项属性(zigzag varint) 选择后的 flags 哈希(u32)
+    // 帧时间差在录制时就量化到微秒，引擎实际用的就是量化后的值，回放因此逐位一致
+    enum class ReplayRecord : std::uint8_t {
+        Frame  = 0,
+        Choice = 1,
+    };
+
+    struct ReplayEvent {
+        ReplayRecord     kind   = ReplayRecord::Frame;
+        float            dt     = 0.f;   // Frame
+        std::uint32_t    choice = 0;     // Choice：场景内下标
+        std::string_view sceneId;        // Choice：做选择时所在的场景（指向日志数据）
+        Stats            stats;          // Choice：选择后的属性
+        std::uint32_t    flagHash = 0;   // Choice：选择后的 flags
+    };
+
+    // 当前 flags 的哈希：按 ID 顺序哈希已置位 flag 的名字
+    std::uint32_t replayFlagHash(const Engine& engine);
+
+    // 录制：每帧调用 frame，每次生效的选择之后调用 choice。
+    // 帧记录攒在内存里，每次选择时连同选择一起写出并刷新，崩溃时最多丢最后几帧
+    class ReplayRecorder {
+    public:
+        ReplayRecorder() = default;
+        ~ReplayRecorder() { close(); }
+
+        ReplayRecorder(const ReplayRecorder&) = delete;
+        ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+
+        // 开始录制到 path；initial 是录制开始时的状态（新开局或读档之后）
+        bool open(const std::filesystem::path& path, const SaveState& initial);
+        // 录到内存（合成回放语料用），结果由 take 取走
+        void openInMemory(const SaveState& initial);
+
+        bool isOpen() const { return recording_; }
+
+        // 记录一帧的时间差，返回量化后的值；调用方必须用返回值推进引擎
+        float frame(float dt);
+
+        // 记录一次已生效的选择（engine.choose 之后调用），fromSceneId 是选择前所在的场景
+        void choice(std::uint32_t choiceIndex, const std::string& fromSceneId, const Engine& engine);
+
+        void close();
+
+        // 内存录制时取走日志内容
+        std::vector<std::uint8_t> take();
+
+    private:
+        void writeHeader(const SaveState& initial);
+        void flushToFile();
+
+        std::ofstream out_;
+        std::vector<std::uint8_t> buffer_;
+        bool recording_ = false;
+        bool toFile_    = false;
+    };
+
+    // 顺序读取一份日志（不持有数据，data 在读取期间必须有效）
+    class ReplayReader {
+    public:
+        ReplayReader(const std::uint8_t* data, std::size_t size);
+
+        // 头部有效，且到目前为止没有读到损坏的记录
+        bool ok() const { return ok_; }
+        const SaveState& initial() const { return initial_; }
+
+        // 取下一条记录；日志结束或损坏（见 ok）时返回 false
+        bool next(ReplayEvent& event);
+
+        // 下一条记录是否为选择（窗口里回放时，帧之后紧跟的选择在同一帧应用）
+        bool choiceNext() const;
+
+    private:
+        const std::uint8_t* p_;
+        const std::uint8_t* end_;
+        SaveState initial_;
+        bool ok_ = false;
+    };
+
+    // 读入整个日志文件
+    bool readReplayFile(const std::filesystem::path& path, std::vector<std::uint8_t>& out);
+
+    // 把一条选择记录应用到引擎上并逐项校验场景、可见性、属性和 flags。
+    // 不一致时返回 false，error 说明第一处差异
+    bool applyReplayChoice(Engine& engine, const ReplayEvent& event,
+                           Engine::ChoiceOutcome& outcome, std::string& error);
+
+    struct ReplayResult {
+        bool          ok      = true;
+        std::uint64_t frames  = 0;
+        std::uint64_t choices = 0;
+        std::string   error;  // 第一处不一致或日志损坏的说明
+    };
+
+    // 无界面全速回放一份日志（剧情图只读，多个线程可以同时回放）
+    ReplayResult replaySession(const StoryGraph& story, const std::uint8_t* data, std::size_t size);
+
+} // namespace CampusSim
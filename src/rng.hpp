@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace CampusSim {
+
+    // SplitMix64：命令行工具（批量模拟、基准、回放、负载生成）共用的小随机数发生器。
+    // 状态只有 64 位，同一个种子在任何平台上得到相同的序列，按块 / 按会话派生种子也很方便
+    struct Rng {
+        std::uint64_t state;
+
+        std::uint64_t next() {
+            std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // [0, n)
+        std::size_t below(std::size_t n) { return static_cast<std::size_t>(next() % n); }
+
+        // [0, 1)
+        double uniform() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+        bool chance(double p) { return uniform() < p; }
+    };
+
+} // namespace CampusSim
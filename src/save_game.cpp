@@ -0,0 +1,180 @@
+#include "save_game.hpp"
+#include "byte_io.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <system_error>
+
+namespace CampusSim {
+
+    namespace {
+
+        constexpr char SAVE_MAGIC[4] = {'C', 'S', 'S', 'V'};
+
+        // 32 位 FNV-1a
+        std::uint32_t checksum(const std::uint8_t* data, std::size_t size) {
+            std::uint32_t h = 2166136261u;
+            for (std::size_t i = 0; i < size; ++i) {
+                h ^= data[i];
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+    } // namespace
+
+    void encodeSave(const SaveState& state, std::vector<std::uint8_t>& out) {
+        out.clear();
+        ByteWriter w(out);
+        w.bytes(SAVE_MAGIC, sizeof(SAVE_MAGIC));
+        w.varint(SAVE_FORMAT_VERSION);
+
+        w.str(state.sceneId);
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            w.svarint(state.stats.*STAT_FIELDS[k]);
+        }
+
+        w.varint(state.flags.size());
+        for (const auto& f : state.flags) w.str(f);
+
+        w.varint(state.timers.size());
+        for (const auto& t : state.timers) {
+            w.varint(t.choice);
+            w.f32(t.remaining);
+        }
+
+        w.u32le(checksum(out.data(), out.size()));
+    }
+
+    bool decodeSave(const std::uint8_t* data, std::size_t size, SaveState& state) {
+        if (size < sizeof(SAVE_MAGIC) + 4 || std::memcmp(data, SAVE_MAGIC, sizeof(SAVE_MAGIC)) != 0) {
+            return false;
+        }
+        ByteReader tail(data + size - 4, 4);
+        if (tail.u32le() != checksum(data, size - 4)) return false;
+
+        ByteReader r(data + sizeof(SAVE_MAGIC), size - sizeof(SAVE_MAGIC) - 4);
+        if (r.varint() != SAVE_FORMAT_VERSION) return false;
+
+        SaveState loaded;
+        loaded.sceneId = r.str();
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            loaded.stats.*STAT_FIELDS[k] = static_cast<int>(r.svarint());
+        }
+
+        // 数量先和剩余字节数比一下，损坏的存档不会触发巨大的分配
+        std::uint64_t flagCount = r.varint();
+        if (flagCount > r.remaining()) return false;
+        loaded.flags.reserve(static_cast<std::size_t>(flagCount));
+        for (std::uint64_t i = 0; i < flagCount && r.ok(); ++i) loaded.flags.push_back(r.str());
+
+        std::uint64_t timerCount = r.varint();
+        if (timerCount > r.remaining()) return false;
+        loaded.timers.reserve(static_cast<std::size_t>(timerCount));
+        for (std::uint64_t i = 0; i < timerCount && r.ok(); ++i) {
+            SaveState::Timer t;
+            t.choice    = static_cast<std::uint32_t>(r.varint());
+            t.remaining = r.f32();
+            loaded.timers.push_back(t);
+        }
+
+        if (!r.ok() || !r.atEnd()) return false;
+        state = std::move(loaded);
+        return true;
+    }
+
+    bool writeSaveFile(const std::filesystem::path& path, const std::vector<std::uint8_t>& bytes) {
+        std::filesystem::path tmpPath = path;
+        tmpPath += ".tmp";
+        {
+            std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!f) {
+                std::cerr << "无法写入存档: " << tmpPath << "\n";
+                return false;
+            }
+            f.write(reinterpret_cast<const char*>(bytes.data()),
+                    static_cast<std::streamsize>(bytes.size()));
+            if (!f) {
+                std::cerr << "写入存档失败: " << tmpPath << "\n";
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, path, ec);
+        if (ec) {
+            std::cerr << "无法替换存档 " << path << ": " << ec.message() << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    bool loadGame(const std::filesystem::path& path, SaveState& state) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;  // 没有存档是正常情况
+
+        std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(in)),
+                                        std::istreambuf_iterator<char>());
+        if (!decodeSave(bytes.data(), bytes.size(), state)) {
+            std::cerr << "存档已损坏或版本不符，将重新开始: " << path << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    // ----------------- 自动存档 -----------------
+
+    AutoSaver::AutoSaver(std::filesystem::path path)
+        : path_(std::move(path)),
+          worker_([this] { writerLoop(); }) {}
+
+    AutoSaver::~AutoSaver() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        worker_.join();
+    }
+
+    void AutoSaver::submit(const SaveState& state) {
+        // 只在交换缓冲区时持锁；写盘线程写文件时不持锁，这里不会被磁盘 I/O 拖住
+        std::lock_guard<std::mutex> lock(mutex_);
+        encodeSave(state, front_);
+        pending_ = true;
+        wake_.notify_one();
+    }
+
+    void AutoSaver::flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return !pending_ && !busy_; });
+    }
+
+    std::uint64_t AutoSaver::writes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return writes_;
+    }
+
+    void AutoSaver::writerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [this] { return pending_ || stop_; });
+            if (!pending_) break;  // 退出前总会先写完最后一份
+
+            front_.swap(back_);
+            pending_ = false;
+            busy_    = true;
+
+            lock.unlock();
+            writeSaveFile(path_, back_);
+            lock.lock();
+
+            busy_ = false;
+            ++writes_;
+            idle_.notify_all();
+        }
+    }
+
+} // namespace CampusSim
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "engine.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CampusSim {
+
+    // 存档格式版本：格式变化时递增，旧版本的存档会被忽略（重新开始）
+    constexpr std::uint32_t SAVE_FORMAT_VERSION = 1;
+
+    // 游戏默认的自动存档路径
+    constexpr const char* SAVE_FILE_PATH = "campus_save.bin";
+
+    // 编码 / 解码一份存档。格式：
+    //   "CSSV" 版本(varint) 场景ID(str) 九项属性(zigzag varint，按 STAT_FIELDS 顺序)
+    //   flag 数(varint) flag 名(str)… 限时选项数(varint) [选项下标(varint) 剩余秒数(f32)]…
+    //   FNV-1a 32 校验(u32)
+    // 字符串为 varint 长度 + UTF-8 字节。典型存档只有几十到几百字节
+    void encodeSave(const SaveState& state, std::vector<std::uint8_t>& out);
+    bool decodeSave(const std::uint8_t* data, std::size_t size, SaveState& state);
+
+    // 同步写入：先写临时文件再改名，任何时刻磁盘上都是一份完整的存档
+    bool writeSaveFile(const std::filesystem::path& path, const std::vector<std::uint8_t>& bytes);
+
+    // 读取存档；文件不存在时静默返回 false，损坏或版本不符时报告后返回 false
+    bool loadGame(const std::filesystem::path& path, SaveState& state);
+
+    // 后台自动存档：submit 在调用线程里把快照编码进前台缓冲区（微秒级），
+    // 写盘线程把它换到后台缓冲区后再慢慢写，渲染循环从不等待磁盘。
+    // 写盘期间又提交的快照只保留最新一份
+    class AutoSaver {
+    public:
+        explicit AutoSaver(std::filesystem::path path);
+        ~AutoSaver();  // 写完尚未写出的快照再退出
+
+        AutoSaver(const AutoSaver&) = delete;
+        AutoSaver& operator=(const AutoSaver&) = delete;
+
+        void submit(const SaveState& state);
+
+        // 阻塞到已提交的快照全部写到磁盘
+        void flush();
+
+        std::uint64_t writes() const;  // 实际写盘次数
+
+    private:
+        void writerLoop();
+
+        std::filesystem::path path_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable wake_;   // 有新快照或要退出
+        std::condition_variable idle_;   // 写完一份
+        std::vector<std::uint8_t> front_;  // 最近一次提交、尚未写出的快照
+        std::vector<std::uint8_t> back_;   // 写盘线程正在写的快照
+        bool pending_ = false;
+        bool busy_    = false;
+        bool stop_    = false;
+        std::uint64_t writes_ = 0;
+
+        std::thread worker_;  // 最后构造，保证线程启动时其他成员都已就绪
+    };
+
+} // namespace CampusSim
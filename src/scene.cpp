@@ -0,0 +1,470 @@
+#include "scene.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <fstream>
+
+namespace CampusSim {
+
+    // ----------------- 工具函数 -----------------
+    //
+    // 解析全程在 std::string_view 上切分，只有最终存进 Scene / Choice 的字符串才分配内存。
+    // 切分规则与原先基于 std::getline 的实现逐字节一致（见 forEachField）
+
+    namespace {
+
+        // 与 C locale 下的 std::isspace 相同：空格 \t \n \v \f \r
+        inline bool isSpace(char c) {
+            return c == ' ' || (c >= '\t' && c <= '\r');
+        }
+
+        // 按 delim 切分并逐项去空白，语义同 getline(iss, item, delim)：
+        // 末尾紧跟分隔符时不产生最后一个空字段，空串不产生任何字段
+        template <typename Fn>
+        void forEachField(std::string_view s, char delim, Fn&& fn) {
+            std::size_t pos = 0;
+            while (pos < s.size()) {
+                std::size_t end = s.find(delim, pos);
+                if (end == std::string_view::npos) end = s.size();
+                fn(trimView(s.substr(pos, end - pos)));
+                pos = end + 1;
+            }
+        }
+
+        // 同 std::stoi（十进制）：跳过前导空白，可带 +/- 号，忽略数字后面的内容，
+        // 没有数字或超出 int 范围时返回 false
+        bool parseInt(std::string_view s, int& value) {
+            std::size_t i = 0;
+            while (i < s.size() && isSpace(s[i])) ++i;
+            if (i < s.size() && s[i] == '+') {
+                ++i;
+                if (i == s.size() || s[i] < '0' || s[i] > '9') return false;
+            }
+            const char* first = s.data() + i;
+            const char* last  = s.data() + s.size();
+            return std::from_chars(first, last, value).ec == std::errc();
+        }
+
+    } // namespace
+
+    std::string_view trimView(std::string_view s) {
+        std::size_t start = 0;
+        while (start < s.size() && isSpace(s[start])) {
+            ++start;
+        }
+        std::size_t end = s.size();
+        while (end > start && isSpace(s[end - 1])) {
+            --end;
+        }
+        return s.substr(start, end - start);
+    }
+
+    std::string trim(const std::string& s) {
+        return std::string(trimView(s));
+    }
+
+    bool startsWith(std::string_view s, std::string_view prefix) {
+        return s.substr(0, prefix.size()) == prefix;
+    }
+
+    std::vector<std::string> split(const std::string& s, char delim) {
+        std::vector<std::string> result;
+        forEachField(s, delim, [&](std::string_view item) { result.emplace_back(item); });
+        return result;
+    }
+
+    int findStatKey(std::string_view key) {
+        // 每项属性的英文名、中文名和单字母缩写（理智没有缩写）
+        static constexpr std::string_view KEYS[STAT_COUNT][3] = {
+            {"physique", "体质", "P"},       {"study", "学力", "X"},
+            {"network", "人脉", "R"},        {"reputation", "名誉", "M"},
+            {"experience", "经验", "J"},     {"san", "理智", ""},
+            {"public", "公能讲座", "G"},     {"volunteer", "志愿服务", "Z"},
+            {"social", "社会实践", "S"},
+        };
+        if (key.empty()) return -1;
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            for (std::string_view alias : KEYS[k]) {
+                if (alias == key) return k;
+            }
+        }
+        return -1;
+    }
+
+    // DELTA 字段：例如 "体质=-1,学力=+2" / "physique=-1,study=+2"
+    void parseDelta(std::string_view s, Choice& choice) {
+        forEachField(s, ',', [&](std::string_view item) {
+            if (item.empty()) return;
+
+            // 恰好两段 "键=值"（"a=" 只算一段，"a==1" 算三段，都忽略）
+            std::string_view kv[2];
+            int parts = 0;
+            forEachField(item, '=', [&](std::string_view part) {
+                if (parts < 2) kv[parts] = part;
+                ++parts;
+            });
+            if (parts != 2) return;
+
+            int value = 0;
+            if (!parseInt(kv[1], value)) return;
+
+            int k = findStatKey(kv[0]);
+            if (k >= 0) choice.*DELTA_FIELDS[k] += value;
+        });
+    }
+
+    // FLAGS 字段：例如 "join_union,oversleep,timed10"
+    void parseFlags(std::string_view s, Choice& choice) {
+        if (s == "0") return;  // 0 作为占位符表示“没有 flags”
+
+        forEachField(s, ',', [&](std::string_view item) {
+            if (item.empty() || item == "0") return;
+
+            // 特殊语法：timed10 / timed5 / timed30 …… 表示限时选项
+            // 规则：以 "timed" 开头、后面是数字才视为限时关键词；
+            // 转数字失败就忽略限时配置，不影响其他 flag
+            if (startsWith(item, "timed") && item.size() > 5) {
+                int seconds = 0;
+                if (parseInt(item.substr(5), seconds) && seconds > 0) {
+                    choice.timed     = true;
+                    choice.timeLimit = static_cast<float>(seconds);
+                }
+                return;  // 不把 timedXX 当成普通 flag 记录
+            }
+
+            // 其他全部作为普通 flag 记录
+            choice.setFlags.emplace_back(item);
+        });
+    }
+
+    // REQUIRES 字段：例如 "research_invite,!join_union,学力>=20"。
+    // 这里只切分，每一项的含义在链接时由 compileCondition 决定
+    void parseRequirements(std::string_view s, std::vector<std::string>& out) {
+        if (s == "0") return; // 0 作为占位符时视为“无条件”
+        forEachField(s, ',', [&](std::string_view item) {
+            if (!item.empty() && item != "0") {
+                out.emplace_back(item);
+            }
+        });
+    }
+
+    // 新的选项格式：支持最多5列，最后一列为 REQUIRES
+    void parseChoiceDefinition(std::string_view line, Scene& scene) {
+        // 只需要前 5 列，多出来的列忽略
+        std::string_view parts[5];
+        std::size_t count = 0;
+        forEachField(line, '|', [&](std::string_view part) {
+            if (count < 5) parts[count] = part;
+            ++count;
+        });
+        if (count == 0) return;
+
+        Choice& choice = scene.choices.emplace_back();
+
+        // 文本（玩家看到的内容）
+        choice.text = std::string(parts[0]);
+
+        std::string_view deltaStr;
+        std::string_view nextId;
+        std::string_view flagsStr;
+        std::string_view requiresStr;
+
+        if (count == 2) {
+            // 文本 | NEXT
+            nextId = parts[1];
+        } else if (count >= 3) {
+            // 文本 | DELTA | NEXT [| FLAGS [| REQUIRES]]
+            deltaStr    = parts[1];
+            nextId      = parts[2];
+            flagsStr    = parts[3];
+            requiresStr = parts[4];
+        }
+        // 只有一列时没有目标场景，载入后按悬空目标报告
+
+        choice.nextSceneId = std::string(nextId);
+        parseDelta(deltaStr, choice);
+        parseFlags(flagsStr, choice);
+        parseRequirements(requiresStr, choice.requirements);
+    }
+
+    // 重定向行：条件 | 目标场景
+    void parseRedirectDefinition(std::string_view line, Scene& scene) {
+        std::string_view parts[2];
+        std::size_t count = 0;
+        forEachField(line, '|', [&](std::string_view part) {
+            if (count < 2) parts[count] = part;
+            ++count;
+        });
+        if (count == 0) return;
+
+        RedirectRule& rule = scene.redirects.emplace_back();
+        if (count == 1) {
+            rule.targetId = std::string(parts[0]);
+        } else {
+            parseRequirements(parts[0], rule.conditions);
+            rule.targetId = std::string(parts[1]);
+        }
+    }
+
+    bool parseSceneSource(std::string_view source, Scene& scene, const std::filesystem::path& path) {
+        // 逐行取出（语义同 std::getline：最后一行没有换行符也算一行）
+        std::size_t pos = 0;
+        auto nextLine = [&](std::string_view& line) {
+            if (pos >= source.size()) return false;
+            std::size_t end = source.find('\n', pos);
+            if (end == std::string_view::npos) end = source.size();
+            line = source.substr(pos, end - pos);
+            pos = end + 1;
+            return true;
+        };
+        auto nextNonEmpty = [&]() {
+            std::string_view line;
+            while (nextLine(line)) {
+                line = trimView(line);
+                if (!line.empty()) return line;
+            }
+            return std::string_view();
+        };
+
+        // 读 ID
+        std::string_view line = nextNonEmpty();
+        if (!startsWith(line, "ID:")) {
+            std::cerr << "场景文件缺少 ID: " << path << "\n";
+            return false;
+        }
+        scene.id = std::string(trimView(line.substr(3)));
+
+        // 读 BG
+        line = nextNonEmpty();
+        if (!startsWith(line, "BG:")) {
+            std::cerr << "场景文件缺少 BG: " << path << "\n";
+            return false;
+        }
+        scene.backgroundPath = std::string(trimView(line.substr(3)));
+
+        // 状态机：TEXT 区 + CHOICE 区 + REDIRECT 区
+        enum class Section {
+            None,
+            Text,
+            Choice,
+            Redirect
+        };
+
+        Section section = Section::None;
+        std::string& dialogue = scene.dialogue;
+        dialogue.clear();
+
+        while (nextLine(line)) {
+            std::string_view t = trimView(line);
+            if (t.empty()) {
+                if (section == Section::Text) {
+                    dialogue += '\n';
+                }
+                continue;
+            }
+
+            if (startsWith(t, "TEXT:")) {
+                section = Section::Text;
+                continue;
+            }
+            if (startsWith(t, "ENDTEXT")) {
+                section = Section::None;
+                continue;
+            }
+            if (startsWith(t, "CHOICE:")) {
+                section = Section::Choice;
+                continue;
+            }
+            if (startsWith(t, "ENDCHOICE")) {
+                section = Section::None;
+                continue;
+            }
+            if (startsWith(t, "REDIRECT:")) {
+                section = Section::Redirect;
+                continue;
+            }
+            if (startsWith(t, "ENDREDIRECT")) {
+                section = Section::None;
+                continue;
+            }
+
+            if (section == Section::Text) {
+                if (!dialogue.empty() && dialogue.back() != '\n') {
+                    dialogue += '\n';
+                }
+                dialogue += t;
+            } else if (section == Section::Choice) {
+                parseChoiceDefinition(t, scene);
+            } else if (section == Section::Redirect) {
+                parseRedirectDefinition(t, scene);
+            } else {
+                // 其他内容忽略
+            }
+        }
+
+        return true;
+    }
+
+    // 读取单个 .scene 文件：整个文件一次读进（每个线程复用的）缓冲区，再在上面切分
+    bool loadSceneFile(const std::filesystem::path& path, Scene& scene) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::cerr << "无法打开场景文件: " << path << "\n";
+            return false;
+        }
+
+        thread_local std::string buffer;
+        in.seekg(0, std::ios::end);
+        std::streamoff size = in.tellg();
+        in.seekg(0, std::ios::beg);
+        buffer.resize(size > 0 ? static_cast<std::size_t>(size) : 0);
+        if (!buffer.empty() && !in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()))) {
+            std::cerr << "读取场景文件失败: " << path << "\n";
+            return false;
+        }
+
+        return parseSceneSource(buffer, scene, path);
+    }
+
+    // 列出场景目录（含子目录）下的所有 .scene 文件（按路径排序，保证载入顺序确定）
+    std::vector<std::filesystem::path> listSceneFiles(const std::string& dir) {
+        std::vector<std::filesystem::path> files;
+        namespace fs = std::filesystem;
+
+        fs::path base(dir);
+        if (!fs::exists(base) || !fs::is_directory(base)) {
+            return files;
+        }
+
+        for (const auto& entry : fs::recursive_directory_iterator(base)) {
+            if (!entry.is_regular_file()) continue;
+            if (entry.path().extension() != ".scene") continue;
+            files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    // 载入整个 scenes 目录：文件读取和解析分给线程池并行完成，
+    // 再按路径顺序合并，同一 ID 出现多次时保留路径靠前的那份并报告
+    std::map<std::string, Scene> loadScenes(const std::string& dir, unsigned threadCount,
+                                            std::map<std::string, std::filesystem::path>* origins) {
+        std::map<std::string, Scene> scenes;
+        namespace fs = std::filesystem;
+
+        fs::path base(dir);
+        if (!fs::exists(base) || !fs::is_directory(base)) {
+            std::cerr << "场景目录不存在: " << dir << "\n";
+            return scenes;
+        }
+
+        auto files = listSceneFiles(dir);
+        std::vector<Scene> parsed(files.size());
+        std::vector<char> ok(files.size(), 0);
+
+        parallelFor(files.size(), threadCount, [&](std::size_t i) {
+            ok[i] = loadSceneFile(files[i], parsed[i]) ? 1 : 0;
+        });
+
+        std::map<std::string, std::size_t> origin;  // 场景 ID -> 被保留的文件下标
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            if (!ok[i]) continue;
+
+            auto [it, inserted] = origin.emplace(parsed[i].id, i);
+            if (!inserted) {
+                std::cerr << "重复的场景 ID " << parsed[i].id << ": " << files[i]
+                          << "（保留 " << files[it->second] << "）\n";
+                continue;
+            }
+            if (origins) (*origins)[parsed[i].id] = files[i];
+            std::string id = parsed[i].id;
+            scenes.emplace(std::move(id), std::move(parsed[i]));
+        }
+
+        return scenes;
+    }
+
+    // ----------------- 条件 -----------------
+
+    namespace {
+
+        // "学力>=20" 这样的属性比较：属性名必须认识，运算符之后必须整个是整数
+        bool parseStatTest(std::string_view term, Condition::Instr& test) {
+            std::size_t pos = term.find_first_of("<>=!");
+            if (pos == std::string_view::npos || pos == 0) return false;
+
+            int stat = findStatKey(trimView(term.substr(0, pos)));
+            if (stat < 0) return false;
+
+            static constexpr struct {
+                std::string_view text;
+                CompareOp op;
+            } OPS[] = {  // 两个字符的运算符排在前面
+                {"<=", CompareOp::LessEqual}, {">=", CompareOp::GreaterEqual},
+                {"==", CompareOp::Equal},     {"!=", CompareOp::NotEqual},
+                {"<", CompareOp::Less},       {">", CompareOp::Greater},
+                {"=", CompareOp::Equal},
+            };
+            std::string_view rest = term.substr(pos);
+            std::size_t opLength = 0;
+            for (const auto& candidate : OPS) {
+                if (startsWith(rest, candidate.text)) {
+                    test.cmp = candidate.op;
+                    opLength = candidate.text.size();
+                    break;
+                }
+            }
+            if (opLength == 0) return false;
+
+            std::string_view number = trimView(rest.substr(opLength));
+            if (!number.empty() && number[0] == '+') {
+                number.remove_prefix(1);
+                if (!number.empty() && number[0] == '-') return false;
+            }
+            int value = 0;
+            const char* last = number.data() + number.size();
+            auto [end, ec] = std::from_chars(number.data(), last, value);
+            if (number.empty() || ec != std::errc() || end != last) return false;
+
+            test.op    = Condition::Op::Stat;
+            test.stat  = static_cast<std::uint8_t>(stat);
+            test.value = value;
+            return true;
+        }
+
+    } // namespace
+
+    void compileCondition(const std::vector<std::string>& terms, FlagTable& table, Condition& out) {
+        out.code.clear();
+        FlagSet required, forbidden;
+        std::vector<Condition::Instr> statTests;
+        for (const auto& term : terms) {
+            Condition::Instr test;
+            if (parseStatTest(term, test)) {
+                statTests.push_back(test);
+                continue;
+            }
+            std::string_view negated = term.size() > 1 && term[0] == '!'
+                ? trimView(std::string_view(term).substr(1))
+                : std::string_view();
+            if (!negated.empty()) {
+                forbidden.set(table.intern(std::string(negated)));
+            } else {
+                required.set(table.intern(term));
+            }
+        }
+
+        std::size_t words = std::max(required.words().size(), forbidden.words().size());
+        for (std::size_t w = 0; w < words; ++w) {
+            Condition::Instr in;
+            in.word      = static_cast<std::uint32_t>(w);
+            in.required  = required.word(w);
+            in.forbidden = forbidden.word(w);
+            if (in.required | in.forbidden) out.code.push_back(in);
+        }
+        out.code.insert(out.code.end(), statTests.begin(), statTests.end());
+    }
+
+} // namespace CampusSim
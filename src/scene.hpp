@@ -0,0 +1,200 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <filesystem>
+#include <cstdint>
+
+#include "flags.hpp"
+
+namespace CampusSim {
+
+    // ----------------- 数据结构 -----------------
+
+    constexpr std::uint32_t NO_SCENE = 0xFFFFFFFFu;  // 没有（或找不到）目标场景
+
+    struct Stats {
+        int physique        = 0;  // 体质
+        int study           = 0;  // 学力
+        int network         = 0;  // 人脉
+        int reputation      = 0;  // 名誉
+        int experience      = 0;  // 经验
+        int san             = 0;  // 理智
+        int GongnengLecture = 0;  // 公能讲座
+        int volunteer       = 0;  // 志愿服务
+        int socialPractice  = 0;  // 社会实践
+    };
+
+    struct GameState {
+        Stats stats;
+        FlagSet flags;  // 记录关键历史选择（按 FlagTable 中的 ID 置位）
+    };
+
+    // 条件里的属性比较
+    enum class CompareOp : std::uint8_t {
+        Less,          // <
+        LessEqual,     // <=
+        Greater,       // >
+        GreaterEqual,  // >=
+        Equal,         // ==（也可以写成 =）
+        NotEqual,      // !=
+    };
+
+    // 编译好的条件：所有项的合取，编成一小段指令顺序执行，任何一条不满足即为 false。
+    // flag 项按 64 位一字合并，一条指令同时检查该字里要求为 true 和为 false 的位；
+    // 属性比较每项一条。求值时只做位运算和整数比较，不查任何字符串；无条件时指令为空
+    struct Condition {
+        enum class Op : std::uint8_t {
+            Flags,  // (flags 的第 word 字 & required) == required，且与 forbidden 不相交
+            Stat,   // STAT_FIELDS[stat] 与 value 按 cmp 比较
+        };
+
+        struct Instr {
+            Op            op        = Op::Flags;
+            CompareOp     cmp       = CompareOp::GreaterEqual;
+            std::uint8_t  stat      = 0;
+            std::uint32_t word      = 0;
+            std::int32_t  value     = 0;
+            std::uint64_t required  = 0;
+            std::uint64_t forbidden = 0;
+        };
+
+        std::vector<Instr> code;  // 先 flag 后属性
+    };
+
+    struct Choice {
+        std::string text;                   // 选项文字（UTF-8）
+        int dPhysique        = 0;           // 体质 变化
+        int dStudy           = 0;           // 学力 变化
+        int dNetwork         = 0;           // 人脉 变化
+        int dReputation      = 0;           // 名誉 变化
+        int dExperience      = 0;           // 经验 变化
+        int dSan             = 0;           // 理智 变化
+        int dGongnengLecture = 0;           // 公能讲座 变化
+        int dVolunteer       = 0;           // 志愿服务 变化
+        int dSocialPractice  = 0;           // 社会实践 变化
+        std::string nextSceneId;            // 下一个场景 ID
+        std::vector<std::string> setFlags;  // 选了这个选项要打的 flag
+        std::vector<std::string> requirements;  // REQUIRES 的各项（见 compileCondition），全部满足才显示
+
+        // 以下由 linkStoryGraph 在载入后填好
+        std::uint32_t nextScene = NO_SCENE;     // nextSceneId 对应的场景下标
+        std::vector<std::uint32_t> setFlagIds;  // setFlags 对应的 flag ID
+        Condition condition;                    // requirements 编译后的条件
+
+        bool  timed          = false;  // 是否为限时选项（FLAGS 中包含 timedXX）
+        float timeLimit      = 0.f;    // 限时总时长（秒）；每局的倒计时在 Engine 里
+    };
+
+    // 重定向规则：选项指向本场景时按顺序检查，第一条满足的规则把目标换成 targetId；
+    // 都不满足就进入本场景。条件在选项的属性变化和 flag 生效之后求值
+    struct RedirectRule {
+        std::vector<std::string> conditions;  // 写法同 REQUIRES，空表示无条件
+        std::string targetId;
+    };
+
+    struct Scene {
+        std::string id;
+        std::string backgroundPath;
+        std::string dialogue;               // 剧情文本（UTF-8，可多行）
+        std::vector<Choice> choices;
+        std::vector<RedirectRule> redirects;  // REDIRECT 区，按书写顺序
+    };
+
+    // 九项属性的固定顺序（体质、学力、人脉、名誉、经验、理智、公能讲座、志愿服务、社会实践），
+    // 批量模拟、剧情包等需要逐项处理属性的地方都按这个顺序
+    constexpr int STAT_COUNT = 9;
+
+    constexpr int Stats::* STAT_FIELDS[STAT_COUNT] = {
+        &Stats::physique, &Stats::study, &Stats::network,
+        &Stats::reputation, &Stats::experience, &Stats::san,
+        &Stats::GongnengLecture, &Stats::volunteer, &Stats::socialPractice
+    };
+
+    constexpr int Choice::* DELTA_FIELDS[STAT_COUNT] = {
+        &Choice::dPhysique, &Choice::dStudy, &Choice::dNetwork,
+        &Choice::dReputation, &Choice::dExperience, &Choice::dSan,
+        &Choice::dGongnengLecture, &Choice::dVolunteer, &Choice::dSocialPractice
+    };
+
+    constexpr const char* STAT_NAMES[STAT_COUNT] = {
+        "体质", "学力", "人脉", "名誉", "经验", "理智", "公能讲座", "志愿服务", "社会实践"
+    };
+
+    // 属性名（DELTA 和条件里的写法：physique / 体质 / P ……）对应的 STAT_FIELDS 下标，不认识时返回 -1
+    int findStatKey(std::string_view key);
+
+    // ----------------- 场景文件解析 -----------------
+
+    std::string_view trimView(std::string_view s);  // 去掉首尾空白，不复制
+    std::string trim(const std::string& s);
+    bool startsWith(std::string_view s, std::string_view prefix);
+    std::vector<std::string> split(const std::string& s, char delim);
+
+    // DELTA 字段：例如 "体质=-1,学力=+2" / "physique=-1,study=+2"
+    void parseDelta(std::string_view s, Choice& choice);
+    // FLAGS 字段：例如 "join_union,oversleep,timed10"
+    void parseFlags(std::string_view s, Choice& choice);
+    // REQUIRES 字段：例如 "research_invite,!join_union,学力>=20"
+    void parseRequirements(std::string_view s, std::vector<std::string>& out);
+    // 选项行：文本 | DELTA | NEXT | FLAGS | REQUIRES（2~5 列）
+    void parseChoiceDefinition(std::string_view line, Scene& scene);
+    // 重定向行：条件 | 目标场景（只有一列时为无条件）
+    void parseRedirectDefinition(std::string_view line, Scene& scene);
+
+    // 解析一份 .scene 文件的完整内容（path 只用于报错）
+    bool parseSceneSource(std::string_view source, Scene& scene, const std::filesystem::path& path);
+    // 读取单个 .scene 文件
+    bool loadSceneFile(const std::filesystem::path& path, Scene& scene);
+
+    // 列出场景目录（含子目录）下的所有 .scene 文件（按路径排序）
+    std::vector<std::filesystem::path> listSceneFiles(const std::string& dir);
+
+    // 载入整个 scenes 目录（多线程解析，threadCount 为 0 时按硬件并发数）。
+    // 重复的场景 ID 会被报告，保留路径排序靠前的那份；
+    // origins 非空时记下每个 ID 保留的是哪个文件（热重载据此忽略重复的副本）
+    std::map<std::string, Scene> loadScenes(const std::string& dir, unsigned threadCount = 0,
+                                            std::map<std::string, std::filesystem::path>* origins = nullptr);
+
+    // ----------------- 条件 -----------------
+
+    // 把 REQUIRES / REDIRECT 的条件项编译成 Condition，flag 名驻留进 table。每一项是：
+    //   name           flag 为 true
+    //   !name          flag 为 false
+    //   学力>=20       属性比较，运算符 < <= > >= == != =，属性名同 DELTA
+    // 只有“认识的属性名 + 运算符 + 整数”才算属性比较，其余都按 flag 名处理，
+    // 所以旧文件里的 flag 名含义不变
+    void compileCondition(const std::vector<std::string>& terms, FlagTable& table, Condition& out);
+
+    inline bool compareStat(int value, CompareOp op, int rhs) {
+        switch (op) {
+        case CompareOp::Less:         return value <  rhs;
+        case CompareOp::LessEqual:    return value <= rhs;
+        case CompareOp::Greater:      return value >  rhs;
+        case CompareOp::GreaterEqual: return value >= rhs;
+        case CompareOp::Equal:        return value == rhs;
+        case CompareOp::NotEqual:     return value != rhs;
+        }
+        return false;
+    }
+
+    inline bool conditionMet(const Condition& cond, const Stats& stats, const FlagSet& flags) {
+        for (const auto& in : cond.code) {
+            if (in.op == Condition::Op::Flags) {
+                std::uint64_t have = flags.word(in.word);
+                if ((in.required & ~have) | (in.forbidden & have)) return false;
+            } else if (!compareStat(stats.*STAT_FIELDS[in.stat], in.cmp, in.value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 选项的 REQUIRES 是否满足
+    inline bool requirementsMet(const Choice& choice, const Stats& stats, const FlagSet& flags) {
+        return conditionMet(choice.condition, stats, flags);
+    }
+
+} // namespace CampusSim
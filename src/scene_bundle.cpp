@@ -0,0 +1,416 @@
+#include "scene_bundle.hpp"
+#include "story_graph.hpp"
+#include "mapped_file.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace CampusSim {
+
+    namespace {
+
+        // ----------------- 文件格式 -----------------
+        //
+        // [BundleHeader]
+        // [字符串偏移表 uint32 × (stringCount + 1)] [字符串数据]
+        // [BundleScene × sceneCount]（按 ID 排序）
+        // [BundleChoice × choiceCount]（按场景顺序连续存放）
+        // [BundleRedirect × redirectCount]（按场景顺序连续存放）
+        // [字符串引用 uint32 × stringRefCount]（flag 名和条件项，指向字符串表）
+        //
+        // 所有字段都是 4 字节对齐的小端整数，映射后可以直接按结构体访问。
+
+        constexpr char          BUNDLE_MAGIC[4]  = {'C', 'S', 'S', 'B'};
+        constexpr std::uint32_t BYTE_ORDER_MARK  = 0x01020304u;
+
+        struct BundleHeader {
+            char          magic[4];
+            std::uint32_t version;
+            std::uint32_t byteOrderMark;
+            std::uint32_t fileSize;
+            std::uint64_t sourceFingerprint;
+            std::uint32_t stringCount;
+            std::uint32_t stringOffsetsOffset;
+            std::uint32_t stringDataOffset;
+            std::uint32_t stringDataSize;
+            std::uint32_t sceneCount;
+            std::uint32_t scenesOffset;
+            std::uint32_t choiceCount;
+            std::uint32_t choicesOffset;
+            std::uint32_t redirectCount;
+            std::uint32_t redirectsOffset;
+            std::uint32_t stringRefCount;
+            std::uint32_t stringRefsOffset;
+        };
+
+        struct BundleScene {
+            std::uint32_t id;             // 字符串 ID
+            std::uint32_t background;     // 字符串 ID
+            std::uint32_t dialogue;       // 字符串 ID
+            std::uint32_t choiceBegin;
+            std::uint32_t choiceCount;
+            std::uint32_t redirectBegin;
+            std::uint32_t redirectCount;
+        };
+
+        struct BundleChoice {
+            std::uint32_t text;                     // 字符串 ID
+            std::int32_t  delta[STAT_COUNT];        // 按 DELTA_FIELDS 的顺序
+            std::uint32_t nextSceneId;              // 字符串 ID（原始目标，重定向在运行时处理）
+            std::uint32_t nextSceneIndex;           // 链接好的目标场景下标，找不到时为 NO_SCENE
+            std::uint32_t setFlagsBegin;
+            std::uint32_t setFlagsCount;
+            std::uint32_t requirementsBegin;        // REQUIRES 的条件项（源文本，载入时编译）
+            std::uint32_t requirementsCount;
+            float         timeLimit;                // 限时秒数，0 表示不限时
+        };
+
+        struct BundleRedirect {
+            std::uint32_t conditionsBegin;          // 条件项（源文本，载入时编译）
+            std::uint32_t conditionsCount;
+            std::uint32_t target;                   // 字符串 ID
+        };
+
+        static_assert(sizeof(BundleHeader) % 4 == 0, "BundleHeader must stay 4-byte aligned");
+        static_assert(sizeof(BundleScene)  % 4 == 0, "BundleScene must stay 4-byte aligned");
+        static_assert(sizeof(BundleChoice) % 4 == 0, "BundleChoice must stay 4-byte aligned");
+        static_assert(sizeof(BundleRedirect) % 4 == 0, "BundleRedirect must stay 4-byte aligned");
+
+        // 写包时的字符串驻留表
+        class StringTable {
+        public:
+            std::uint32_t intern(const std::string& s) {
+                auto it = ids.find(s);
+                if (it != ids.end()) return it->second;
+                auto id = static_cast<std::uint32_t>(offsets.size());
+                offsets.push_back(static_cast<std::uint32_t>(data.size()));
+                data += s;
+                ids.emplace(s, id);
+                return id;
+            }
+
+            std::uint32_t count() const { return static_cast<std::uint32_t>(offsets.size()); }
+
+            std::vector<std::uint32_t> offsets;
+            std::string data;
+
+        private:
+            std::unordered_map<std::string, std::uint32_t> ids;
+        };
+
+        template <typename T>
+        void appendPod(std::vector<std::uint8_t>& out, const T& value) {
+            const auto* p = reinterpret_cast<const std::uint8_t*>(&value);
+            out.insert(out.end(), p, p + sizeof(T));
+        }
+
+        void alignTo4(std::vector<std::uint8_t>& out) {
+            while (out.size() % 4 != 0) out.push_back(0);
+        }
+
+        // 64 位 FNV-1a
+        void hashBytes(std::uint64_t& h, const void* data, std::size_t size) {
+            const auto* p = static_cast<const std::uint8_t*>(data);
+            for (std::size_t i = 0; i < size; ++i) {
+                h ^= p[i];
+                h *= 1099511628211ull;
+            }
+        }
+
+        bool isLittleEndianHost() {
+            std::uint32_t probe = 1;
+            std::uint8_t first = 0;
+            std::memcpy(&first, &probe, 1);
+            return first == 1;
+        }
+
+    } // namespace
+
+    std::uint64_t fingerprintSceneDir(const std::string& dir) {
+        namespace fs = std::filesystem;
+
+        fs::path base(dir);
+        if (!fs::exists(base) || !fs::is_directory(base)) return 0;
+
+        std::uint64_t h = 14695981039346656037ull;
+        for (const auto& path : listSceneFiles(dir)) {
+            std::error_code ec;
+            std::string rel = fs::relative(path, base, ec).generic_u8string();
+            if (ec) rel = path.generic_u8string();
+            std::uint64_t size  = fs::file_size(path, ec);
+            std::int64_t  mtime = static_cast<std::int64_t>(
+                fs::last_write_time(path, ec).time_since_epoch().count());
+
+            hashBytes(h, rel.data(), rel.size());
+            hashBytes(h, "\0", 1);
+            hashBytes(h, &size, sizeof(size));
+            hashBytes(h, &mtime, sizeof(mtime));
+        }
+        return h;
+    }
+
+    bool writeSceneBundle(const StoryGraph& graph,
+                          std::uint64_t sourceFingerprint,
+                          const std::filesystem::path& outPath) {
+        if (!isLittleEndianHost()) {
+            std::cerr << "剧情包只支持小端平台\n";
+            return false;
+        }
+
+        StringTable strings;
+        std::vector<BundleScene> sceneRecords;
+        std::vector<BundleChoice> choiceRecords;
+        std::vector<BundleRedirect> redirectRecords;
+        std::vector<std::uint32_t> stringRefs;
+        auto appendRefs = [&](const std::vector<std::string>& list, std::uint32_t& begin, std::uint32_t& count) {
+            begin = static_cast<std::uint32_t>(stringRefs.size());
+            count = static_cast<std::uint32_t>(list.size());
+            for (const auto& item : list) stringRefs.push_back(strings.intern(item));
+        };
+
+        // 场景和选项的顺序与 StoryGraph 完全一致，下标可以原样写入
+        for (const auto& node : graph.scenes) {
+            BundleScene rec{};
+            rec.id          = strings.intern(node.id);
+            rec.background  = strings.intern(node.backgroundPath);
+            rec.dialogue    = strings.intern(node.dialogue);
+            rec.choiceBegin = node.choiceBegin;
+            rec.choiceCount = node.choiceEnd - node.choiceBegin;
+            rec.redirectBegin = static_cast<std::uint32_t>(redirectRecords.size());
+            rec.redirectCount = static_cast<std::uint32_t>(node.redirectRules.size());
+            for (const auto& rule : node.redirectRules) {
+                BundleRedirect r{};
+                appendRefs(rule.conditions, r.conditionsBegin, r.conditionsCount);
+                r.target = strings.intern(rule.targetId);
+                redirectRecords.push_back(r);
+            }
+            sceneRecords.push_back(rec);
+        }
+
+        for (const auto& choice : graph.choices) {
+            BundleChoice c{};
+            c.text = strings.intern(choice.text);
+            for (int k = 0; k < STAT_COUNT; ++k) {
+                c.delta[k] = choice.*DELTA_FIELDS[k];
+            }
+            c.nextSceneId    = strings.intern(choice.nextSceneId);
+            c.nextSceneIndex = choice.nextScene;
+
+            appendRefs(choice.setFlags, c.setFlagsBegin, c.setFlagsCount);
+            appendRefs(choice.requirements, c.requirementsBegin, c.requirementsCount);
+
+            c.timeLimit = choice.timed ? choice.timeLimit : 0.f;
+            choiceRecords.push_back(c);
+        }
+        strings.offsets.push_back(static_cast<std::uint32_t>(strings.data.size()));
+
+        BundleHeader header{};
+        std::memcpy(header.magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+        header.version           = SCENE_BUNDLE_VERSION;
+        header.byteOrderMark     = BYTE_ORDER_MARK;
+        header.sourceFingerprint = sourceFingerprint;
+        header.stringCount       = strings.count();
+        header.sceneCount        = static_cast<std::uint32_t>(sceneRecords.size());
+        header.choiceCount       = static_cast<std::uint32_t>(choiceRecords.size());
+        header.redirectCount     = static_cast<std::uint32_t>(redirectRecords.size());
+        header.stringRefCount    = static_cast<std::uint32_t>(stringRefs.size());
+
+        std::vector<std::uint8_t> out;
+        out.resize(sizeof(BundleHeader));
+
+        header.stringOffsetsOffset = static_cast<std::uint32_t>(out.size());
+        for (auto off : strings.offsets) appendPod(out, off);
+
+        header.stringDataOffset = static_cast<std::uint32_t>(out.size());
+        header.stringDataSize   = static_cast<std::uint32_t>(strings.data.size());
+        out.insert(out.end(), strings.data.begin(), strings.data.end());
+        alignTo4(out);
+
+        header.scenesOffset = static_cast<std::uint32_t>(out.size());
+        for (const auto& rec : sceneRecords) appendPod(out, rec);
+
+        header.choicesOffset = static_cast<std::uint32_t>(out.size());
+        for (const auto& rec : choiceRecords) appendPod(out, rec);
+
+        header.redirectsOffset = static_cast<std::uint32_t>(out.size());
+        for (const auto& rec : redirectRecords) appendPod(out, rec);
+
+        header.stringRefsOffset = static_cast<std::uint32_t>(out.size());
+        for (auto ref : stringRefs) appendPod(out, ref);
+
+        header.fileSize = static_cast<std::uint32_t>(out.size());
+        std::memcpy(out.data(), &header, sizeof(header));
+
+        std::filesystem::path tmpPath = outPath;
+        tmpPath += ".tmp";
+        {
+            std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!f) {
+                std::cerr << "无法写入剧情包: " << tmpPath << "\n";
+                return false;
+            }
+            f.write(reinterpret_cast<const char*>(out.data()),
+                    static_cast<std::streamsize>(out.size()));
+            if (!f) {
+                std::cerr << "写入剧情包失败: " << tmpPath << "\n";
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, outPath, ec);
+        if (ec) {
+            std::cerr << "无法替换剧情包 " << outPath << ": " << ec.message() << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    bool loadSceneBundle(const std::filesystem::path& bundlePath,
+                         const std::string& sourceDir,
+                         StoryGraph& graph) {
+        MappedFile file;
+        if (!file.open(bundlePath)) return false;  // 没有剧情包是正常情况，静默回退
+
+        const std::uint8_t* base = file.data();
+        const std::size_t   size = file.size();
+
+        auto inRange = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t elemSize) {
+            return offset % 4 == 0 && offset <= size && count * elemSize <= size - offset;
+        };
+
+        if (size < sizeof(BundleHeader)) {
+            std::cerr << "剧情包已损坏: " << bundlePath << "\n";
+            return false;
+        }
+        const auto& header = *reinterpret_cast<const BundleHeader*>(base);
+        if (std::memcmp(header.magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0 ||
+            header.byteOrderMark != BYTE_ORDER_MARK || header.fileSize != size) {
+            std::cerr << "剧情包已损坏: " << bundlePath << "\n";
+            return false;
+        }
+        if (header.version != SCENE_BUNDLE_VERSION) {
+            std::cerr << "剧情包版本不符（" << header.version << "），改为读取 .scene 文件\n";
+            return false;
+        }
+
+        std::uint64_t fingerprint = fingerprintSceneDir(sourceDir);
+        if (fingerprint != 0 && fingerprint != header.sourceFingerprint) {
+            std::cerr << "剧情包已过期，改为读取 .scene 文件（请重新运行 scenec）\n";
+            return false;
+        }
+
+        if (!inRange(header.stringOffsetsOffset, std::uint64_t(header.stringCount) + 1, 4) ||
+            header.stringDataOffset > size ||
+            header.stringDataSize > size - header.stringDataOffset ||
+            !inRange(header.scenesOffset, header.sceneCount, sizeof(BundleScene)) ||
+            !inRange(header.choicesOffset, header.choiceCount, sizeof(BundleChoice)) ||
+            !inRange(header.redirectsOffset, header.redirectCount, sizeof(BundleRedirect)) ||
+            !inRange(header.stringRefsOffset, header.stringRefCount, 4)) {
+            std::cerr << "剧情包已损坏: " << bundlePath << "\n";
+            return false;
+        }
+
+        const auto* stringOffsets = reinterpret_cast<const std::uint32_t*>(base + header.stringOffsetsOffset);
+        const char* stringData    = reinterpret_cast<const char*>(base + header.stringDataOffset);
+        const auto* sceneRecords  = reinterpret_cast<const BundleScene*>(base + header.scenesOffset);
+        const auto* choiceRecords = reinterpret_cast<const BundleChoice*>(base + header.choicesOffset);
+        const auto* redirectRecords = reinterpret_cast<const BundleRedirect*>(base + header.redirectsOffset);
+        const auto* stringRefs    = reinterpret_cast<const std::uint32_t*>(base + header.stringRefsOffset);
+
+        bool corrupt = false;
+        auto str = [&](std::uint32_t id) -> std::string {
+            if (id >= header.stringCount) {
+                corrupt = true;
+                return {};
+            }
+            std::uint32_t begin = stringOffsets[id];
+            std::uint32_t end   = stringOffsets[id + 1];
+            if (begin > end || end > header.stringDataSize) {
+                corrupt = true;
+                return {};
+            }
+            return std::string(stringData + begin, end - begin);
+        };
+        auto refList = [&](std::uint32_t begin, std::uint32_t count, std::vector<std::string>& out) {
+            if (begin > header.stringRefCount || count > header.stringRefCount - begin) {
+                corrupt = true;
+                return;
+            }
+            out.reserve(count);
+            for (std::uint32_t i = 0; i < count; ++i) out.push_back(str(stringRefs[begin + i]));
+        };
+
+        StoryGraph loaded;
+        loaded.scenes.reserve(header.sceneCount);
+        loaded.choices.reserve(header.choiceCount);
+
+        for (std::uint32_t si = 0; si < header.sceneCount && !corrupt; ++si) {
+            const BundleScene& rec = sceneRecords[si];
+            if (rec.choiceBegin != loaded.choices.size() ||
+                rec.choiceCount > header.choiceCount - rec.choiceBegin ||
+                rec.redirectBegin > header.redirectCount ||
+                rec.redirectCount > header.redirectCount - rec.redirectBegin) {
+                corrupt = true;
+                break;
+            }
+
+            SceneNode node;
+            node.id             = str(rec.id);
+            node.backgroundPath = str(rec.background);
+            node.dialogue       = str(rec.dialogue);
+            node.choiceBegin    = rec.choiceBegin;
+            node.choiceEnd      = rec.choiceBegin + rec.choiceCount;
+
+            node.redirectRules.resize(rec.redirectCount);
+            for (std::uint32_t ri = 0; ri < rec.redirectCount; ++ri) {
+                const BundleRedirect& r = redirectRecords[rec.redirectBegin + ri];
+                refList(r.conditionsBegin, r.conditionsCount, node.redirectRules[ri].conditions);
+                node.redirectRules[ri].targetId = str(r.target);
+            }
+
+            for (std::uint32_t ci = node.choiceBegin; ci < node.choiceEnd; ++ci) {
+                const BundleChoice& c = choiceRecords[ci];
+                Choice choice;
+                choice.text = str(c.text);
+                for (int k = 0; k < STAT_COUNT; ++k) {
+                    choice.*DELTA_FIELDS[k] = c.delta[k];
+                }
+                choice.nextSceneId = str(c.nextSceneId);
+                choice.nextScene   = c.nextSceneIndex < header.sceneCount ? c.nextSceneIndex : NO_SCENE;
+                refList(c.setFlagsBegin, c.setFlagsCount, choice.setFlags);
+                refList(c.requirementsBegin, c.requirementsCount, choice.requirements);
+                if (c.timeLimit > 0.f) {
+                    choice.timed     = true;
+                    choice.timeLimit = c.timeLimit;
+                }
+                loaded.choices.push_back(std::move(choice));
+            }
+
+            loaded.scenes.push_back(std::move(node));
+        }
+
+        if (corrupt || loaded.choices.size() != header.choiceCount) {
+            std::cerr << "剧情包已损坏: " << bundlePath << "\n";
+            return false;
+        }
+
+        // 目标下标已在编译时解析，这里只需建索引、驻留 flag、编译条件、链接重定向规则
+        linkStoryGraph(loaded);
+        graph = std::move(loaded);
+        return true;
+    }
+
+    StoryGraph loadStory(const std::string& sceneDir, const std::filesystem::path& bundlePath) {
+        StoryGraph graph;
+        if (!loadSceneBundle(bundlePath, sceneDir, graph)) {
+            graph = buildStoryGraph(loadScenes(sceneDir));
+        }
+        return graph;
+    }
+
+} // namespace CampusSim
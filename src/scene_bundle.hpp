@@ -0,0 +1,37 @@
+#pragma once
+
+#include "story_graph.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace CampusSim {
+
+    // 二进制剧情包的格式版本：格式变化时递增，旧包会被判定为过期
+    constexpr std::uint32_t SCENE_BUNDLE_VERSION = 2;
+
+    // 游戏默认读取的剧情包路径（由 scenec 生成）
+    constexpr const char* SCENE_BUNDLE_PATH = "scenes.bundle";
+
+    // 源场景目录的指纹：所有 .scene 文件的相对路径、大小和修改时间。
+    // 只做 stat，不读文件内容；目录不存在时返回 0
+    std::uint64_t fingerprintSceneDir(const std::string& dir);
+
+    // 把链接好的剧情图写成二进制剧情包（先写临时文件再改名）
+    bool writeSceneBundle(const StoryGraph& graph,
+                          std::uint64_t sourceFingerprint,
+                          const std::filesystem::path& outPath);
+
+    // 通过内存映射读取剧情包，直接得到链接好的剧情图，不解析任何文本。
+    // 包不存在、版本不符、内容损坏，或 sourceDir 存在且指纹对不上（包已过期）时返回 false，
+    // 调用方应回退到 loadScenes
+    bool loadSceneBundle(const std::filesystem::path& bundlePath,
+                         const std::string& sourceDir,
+                         StoryGraph& graph);
+
+    // 载入剧情：优先映射剧情包，缺失或过期时回退到解析 sceneDir 下的 .scene 文件
+    StoryGraph loadStory(const std::string& sceneDir = "scenes",
+                         const std::filesystem::path& bundlePath = SCENE_BUNDLE_PATH);
+
+} // namespace CampusSim
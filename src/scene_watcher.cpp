@@ -0,0 +1,123 @@
+#include "scene_watcher.hpp"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace CampusSim {
+
+    namespace fs = std::filesystem;
+
+#ifdef __linux__
+
+    namespace {
+
+        // 文件保存（直接写入，或写临时文件再改名过来）、新建 / 移入子目录
+        constexpr std::uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+    } // namespace
+
+    SceneWatcher::~SceneWatcher() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    bool SceneWatcher::start(const std::string& dir) {
+        std::error_code ec;
+        if (!fs::is_directory(dir, ec)) {
+            std::cerr << "无法监视场景目录: " << dir << "\n";
+            return false;
+        }
+
+        fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd_ < 0) {
+            std::cerr << "inotify 初始化失败: " << std::strerror(errno) << "\n";
+            return false;
+        }
+
+        addWatch(dir);
+        for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_directory(ec)) addWatch(it->path());
+        }
+        return !watches_.empty();
+    }
+
+    void SceneWatcher::addWatch(const fs::path& dir) {
+        int wd = inotify_add_watch(fd_, dir.c_str(), WATCH_MASK);
+        if (wd < 0) {
+            std::cerr << "无法监视目录 " << dir << ": " << std::strerror(errno) << "\n";
+            return;
+        }
+        watches_[wd] = dir;
+    }
+
+    std::vector<fs::path> SceneWatcher::poll() {
+        std::vector<fs::path> ready;
+        if (fd_ < 0) return ready;
+
+        auto now = std::chrono::steady_clock::now();
+
+        alignas(inotify_event) char buf[16 * 1024];
+        while (true) {
+            ssize_t n = ::read(fd_, buf, sizeof(buf));
+            if (n <= 0) break;  // EAGAIN：没有更多事件
+
+            for (ssize_t off = 0; off < n;) {
+                const auto* ev = reinterpret_cast<const inotify_event*>(buf + off);
+                off += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+
+                auto dir = watches_.find(ev->wd);
+                if (dir == watches_.end() || ev->len == 0) continue;
+                fs::path path = dir->second / ev->name;
+
+                if (ev->mask & IN_ISDIR) {
+                    // 新目录里可能已经有文件（例如整个目录拷进来），一并排队
+                    if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        addWatch(path);
+                        std::error_code ec;
+                        for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+                            if (it->is_directory(ec)) addWatch(it->path());
+                            else if (it->path().extension() == ".scene") pending_[it->path()] = now;
+                        }
+                    }
+                    continue;
+                }
+
+                // IN_CREATE 之后还会有 IN_CLOSE_WRITE，这里只刷新去抖计时
+                if (path.extension() == ".scene") pending_[path] = now;
+            }
+        }
+
+        const auto debounce = std::chrono::milliseconds(SCENE_WATCH_DEBOUNCE);
+        for (auto it = pending_.begin(); it != pending_.end();) {
+            if (now - it->second >= debounce) {
+                ready.push_back(it->first);
+                it = pending_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return ready;
+    }
+
+#else
+
+    SceneWatcher::~SceneWatcher() = default;
+
+    bool SceneWatcher::start(const std::string&) {
+        std::cerr << "--watch 目前只支持 Linux（inotify）\n";
+        return false;
+    }
+
+    void SceneWatcher::addWatch(const fs::path&) {}
+
+    std::vector<fs::path> SceneWatcher::poll() { return {}; }
+
+#endif
+
+} // namespace CampusSim
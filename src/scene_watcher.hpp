@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CampusSim {
+
+    // 编辑器保存时往往连续触发多次写入 / 改名，同一文件静默这么久之后才算保存完成
+#ifndef SCENE_WATCH_DEBOUNCE_MS
+    constexpr int SCENE_WATCH_DEBOUNCE = 200;
+#else
+    constexpr int SCENE_WATCH_DEBOUNCE = SCENE_WATCH_DEBOUNCE_MS;
+#endif
+
+    // 监视场景目录（含子目录）里 .scene 文件的保存，供 --watch 热重载使用。
+    // 目前基于 Linux inotify；其它平台上 start 返回 false
+    class SceneWatcher {
+    public:
+        SceneWatcher() = default;
+        ~SceneWatcher();
+
+        SceneWatcher(const SceneWatcher&) = delete;
+        SceneWatcher& operator=(const SceneWatcher&) = delete;
+
+        // 开始监视 dir；新建的子目录会自动加入
+        bool start(const std::string& dir);
+
+        // 非阻塞：取出已经静默超过去抖时间的 .scene 文件（按路径排序，每个只出现一次）
+        std::vector<std::filesystem::path> poll();
+
+    private:
+        void addWatch(const std::filesystem::path& dir);
+
+        int fd_ = -1;
+        std::unordered_map<int, std::filesystem::path> watches_;  // inotify watch -> 目录
+        std::map<std::filesystem::path, std::chrono::steady_clock::time_point> pending_;
+    };
+
+} // namespace CampusSim
@@ -0,0 +1,230 @@
+#include "session_server.hpp"
+#include "parse_number.hpp"
+
+#include <charconv>
+#include <vector>
+
+namespace CampusSim {
+
+    namespace {
+
+        // 取出下一个以空白分隔的词，line 前进到词之后
+        std::string_view nextWord(std::string_view& line) {
+            line = trimView(line);
+            std::size_t end = line.find_first_of(" \t");
+            if (end == std::string_view::npos) end = line.size();
+            std::string_view word = line.substr(0, end);
+            line.remove_prefix(end);
+            return word;
+        }
+
+        void appendInt(std::string& out, long long v) {
+            char buf[24];
+            auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+            (void)ec;
+            out.append(buf, end);
+        }
+
+    } // namespace
+
+    SessionServer::SessionServer(const StoryGraph& story, unsigned workerThreads)
+        : story_(story), workerThreads_(workerThreads) {}
+
+    std::shared_ptr<SessionServer::Session> SessionServer::find(std::uint64_t id) {
+        Shard& shard = shardOf(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.sessions.find(id);
+        return it == shard.sessions.end() ? nullptr : it->second;
+    }
+
+    bool SessionServer::handle(std::string_view line, std::string& out) {
+        out.clear();
+        std::string_view command = nextWord(line);
+
+        if (command == "NEW") {
+            std::string_view sceneId = nextWord(line);
+            handleNew(sceneId.empty() ? std::string_view("start") : sceneId, out);
+            return true;
+        }
+        if (command == "INFO") {
+            out = "OK sessions=";
+            appendInt(out, static_cast<long long>(sessionCount()));
+            out += " threads=";
+            appendInt(out, workerThreads_);
+            return true;
+        }
+        if (command == "QUIT") {
+            out = "OK";
+            return false;
+        }
+        if (command != "LIST" && command != "CHOOSE" && command != "STATS" && command != "END") {
+            out = command.empty() ? "ERR bad-request" : "ERR unknown-command";
+            return true;
+        }
+
+        std::uint64_t id = 0;
+        if (!parseNumber(nextWord(line), id)) {
+            out = "ERR bad-request";
+            return true;
+        }
+        if (command == "END") {
+            out = handleEnd(id) ? "OK" : "ERR unknown-session";
+            return true;
+        }
+
+        std::shared_ptr<Session> session = find(id);
+        if (!session) {
+            out = "ERR unknown-session";
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(session->mutex);
+        if (session->expired) {
+            out = "ERR unknown-session";
+            return true;
+        }
+        // 先把限时选项推进到当前时刻
+        auto now = Clock::now();
+        session->engine.advance(std::chrono::duration<float>(now - session->lastRequest).count());
+        session->lastRequest = now;
+
+        if (command == "LIST") {
+            handleList(*session, out);
+        } else if (command == "CHOOSE") {
+            handleChoose(*session, nextWord(line), out);
+        } else {
+            handleStats(*session, out);
+        }
+        return true;
+    }
+
+    void SessionServer::handleNew(std::string_view sceneId, std::string& out) {
+        if (count_.fetch_add(1, std::memory_order_relaxed) >= SERVER_MAX_SESSIONS) {
+            count_.fetch_sub(1, std::memory_order_relaxed);
+            out = "ERR full";
+            return;
+        }
+
+        auto session = std::make_shared<Session>(story_);
+        if (!session->engine.start(std::string(sceneId))) {
+            count_.fetch_sub(1, std::memory_order_relaxed);
+            out = "ERR no-scene";
+            return;
+        }
+        session->lastRequest = Clock::now();
+
+        std::uint64_t id = nextId_.fetch_add(1, std::memory_order_relaxed);
+        {
+            Shard& shard = shardOf(id);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.sessions.emplace(id, session);
+        }
+
+        out = "OK ";
+        appendInt(out, static_cast<long long>(id));
+        out += ' ';
+        out += session->engine.currentScene().id;
+    }
+
+    void SessionServer::handleList(Session& session, std::string& out) {
+        thread_local std::vector<std::size_t> visible;
+        const Engine& engine = session.engine;
+        engine.visibleChoices(visible);
+
+        out = "OK ";
+        out += engine.currentScene().id;
+        out += ' ';
+        appendInt(out, static_cast<long long>(visible.size()));
+
+        auto choices = engine.currentChoices();
+        for (std::size_t i : visible) {
+            out += '\t';
+            appendInt(out, static_cast<long long>(i));
+            out += ' ';
+            appendInt(out, engine.countdown(i));
+            out += ' ';
+            // 响应按制表符分隔，选项文字里的制表符换成空格
+            std::size_t from = out.size();
+            out += choices[i].text;
+            for (std::size_t c = from; c < out.size(); ++c) {
+                if (out[c] == '\t') out[c] = ' ';
+            }
+        }
+    }
+
+    void SessionServer::handleChoose(Session& session, std::string_view index, std::string& out) {
+        std::size_t choice = 0;
+        if (!parseNumber(index, choice)) {
+            out = "ERR bad-request";
+            return;
+        }
+        Engine& engine = session.engine;
+        if (choice >= engine.currentChoices().size() || !engine.choiceVisible(choice)) {
+            out = "ERR not-visible";
+            return;
+        }
+        engine.choose(choice);
+        out = "OK ";
+        out += engine.currentScene().id;
+    }
+
+    void SessionServer::handleStats(Session& session, std::string& out) {
+        const GameState& state = session.engine.state();
+        out = "OK";
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            out += ' ';
+            appendInt(out, state.stats.*STAT_FIELDS[k]);
+        }
+
+        out += ' ';
+        std::size_t before = out.size();
+        for (std::uint32_t id = 0; id < story_.flags.size(); ++id) {
+            if (!state.flags.test(id)) continue;
+            if (out.size() != before) out += ',';
+            out += story_.flags.name(id);
+        }
+        if (out.size() == before) out += '-';
+    }
+
+    bool SessionServer::handleEnd(std::uint64_t id) {
+        std::shared_ptr<Session> removed;  // 在锁外析构
+        {
+            Shard& shard = shardOf(id);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.sessions.find(id);
+            if (it == shard.sessions.end()) return false;
+            removed = std::move(it->second);
+            shard.sessions.erase(it);
+        }
+        count_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::size_t SessionServer::expireIdle(Clock::duration maxIdle) {
+        std::size_t expired = 0;
+        auto now = Clock::now();
+        std::vector<std::shared_ptr<Session>> removed;  // 在锁外析构
+        for (auto& shard : shards_) {
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                for (auto it = shard.sessions.begin(); it != shard.sessions.end();) {
+                    // 正在处理请求的会话跳过，下一轮再看
+                    std::unique_lock<std::mutex> busy(it->second->mutex, std::try_to_lock);
+                    if (busy && now - it->second->lastRequest > maxIdle) {
+                        it->second->expired = true;
+                        busy.unlock();
+                        removed.push_back(std::move(it->second));
+                        it = shard.sessions.erase(it);
+                        ++expired;
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+            removed.clear();
+        }
+        count_.fetch_sub(expired, std::memory_order_relaxed);
+        return expired;
+    }
+
+} // namespace CampusSim
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "engine.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace CampusSim {
+
+    // 同时存在的会话数上限，超过时 NEW 返回 ERR full
+#ifndef SERVER_MAX_SESSIONS_LIMIT
+    constexpr std::size_t SERVER_MAX_SESSIONS = 200000;
+#else
+    constexpr std::size_t SERVER_MAX_SESSIONS = SERVER_MAX_SESSIONS_LIMIT;
+#endif
+
+    // 多会话剧情服务的协议处理：所有会话共用一份只读的 StoryGraph，每个会话只有一个 Engine
+    // （属性、flags、当前场景和限时选项的计时器）。一行请求对应一行响应：
+    //
+    //   NEW [场景ID]          -> OK <会话> <场景ID>          （默认从 start 开始）
+    //   LIST <会话>           -> OK <场景ID> <可见数>[\t<下标> <倒计时> <文本>]...
+    //   CHOOSE <会话> <下标>  -> OK <新场景ID>
+    //   STATS <会话>          -> OK <九项属性，按 STAT_FIELDS 顺序> <flags，逗号分隔，没有为 ->
+    //   END <会话>            -> OK
+    //   INFO                  -> OK sessions=<会话数> threads=<工作线程数>
+    //   QUIT                  -> OK（随后断开）
+    //
+    // 出错时为 ERR <原因>：bad-request / unknown-command / unknown-session / no-scene /
+    // not-visible / full。限时选项按真实时间倒计时：每个请求先把会话推进到当前时刻。
+    // handle 可以被任意多个线程同时调用；同一会话的请求串行执行
+    class SessionServer {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // workerThreads 只用于 INFO 的回报（负载测试据此折算每核的吞吐）
+        explicit SessionServer(const StoryGraph& story, unsigned workerThreads = 1);
+
+        SessionServer(const SessionServer&) = delete;
+        SessionServer& operator=(const SessionServer&) = delete;
+
+        // 处理一行请求（不含换行），响应写进 out（不含换行）。
+        // 返回 false 表示客户端请求断开（QUIT）
+        bool handle(std::string_view line, std::string& out);
+
+        std::size_t sessionCount() const { return count_.load(std::memory_order_relaxed); }
+
+        // 结束超过 maxIdle 没有请求的会话，返回结束的个数
+        std::size_t expireIdle(Clock::duration maxIdle);
+
+    private:
+        struct Session {
+            explicit Session(const StoryGraph& story) : engine(story) {}
+
+            std::mutex mutex;
+            Engine engine;
+            Clock::time_point lastRequest;
+            // 已被 expireIdle 移出表（在 mutex 下设置）。请求可能在查表之后、拿到 mutex 之前
+            // 被超时回收抢先，此时不能再推进它
+            bool expired = false;
+        };
+
+        // 按会话号分片加锁，查表时线程之间很少抢同一把锁
+        static constexpr std::size_t SHARDS = 64;
+        struct Shard {
+            std::mutex mutex;
+            std::unordered_map<std::uint64_t, std::shared_ptr<Session>> sessions;
+        };
+
+        Shard& shardOf(std::uint64_t id) { return shards_[id % SHARDS]; }
+        std::shared_ptr<Session> find(std::uint64_t id);
+
+        void handleNew(std::string_view sceneId, std::string& out);
+        void handleList(Session& session, std::string& out);
+        void handleChoose(Session& session, std::string_view index, std::string& out);
+        void handleStats(Session& session, std::string& out);
+        bool handleEnd(std::uint64_t id);
+
+        const StoryGraph& story_;
+        unsigned workerThreads_;
+        Shard shards_[SHARDS];
+        std::atomic<std::uint64_t> nextId_{1};
+        std::atomic<std::size_t> count_{0};
+    };
+
+} // namespace CampusSim
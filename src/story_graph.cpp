@@ -0,0 +1,145 @@
+#include "story_graph.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+
+namespace CampusSim {
+
+    StoryGraph buildStoryGraph(std::map<std::string, Scene> scenes) {
+        StoryGraph graph;
+        graph.scenes.reserve(scenes.size());
+
+        std::size_t choiceCount = 0;
+        for (const auto& [id, scene] : scenes) choiceCount += scene.choices.size();
+        graph.choices.reserve(choiceCount);
+
+        for (auto& [id, scene] : scenes) {
+            SceneNode node;
+            node.id             = std::move(scene.id);
+            node.backgroundPath = std::move(scene.backgroundPath);
+            node.dialogue       = std::move(scene.dialogue);
+            node.redirectRules  = std::move(scene.redirects);
+            node.choiceBegin    = static_cast<std::uint32_t>(graph.choices.size());
+            for (auto& choice : scene.choices) {
+                graph.choices.push_back(std::move(choice));
+            }
+            node.choiceEnd = static_cast<std::uint32_t>(graph.choices.size());
+            graph.scenes.push_back(std::move(node));
+        }
+
+        linkStoryGraph(graph);
+        return graph;
+    }
+
+    std::size_t linkStoryGraph(StoryGraph& graph, bool report) {
+        graph.sceneIndex.clear();
+        graph.sceneIndex.reserve(graph.scenes.size());
+        for (std::uint32_t i = 0; i < graph.scenes.size(); ++i) {
+            graph.sceneIndex.emplace(graph.scenes[i].id, i);
+        }
+
+        std::size_t dangling = 0;
+        auto reportDangling = [&](std::uint32_t scene, const Choice& choice, const std::string& target) {
+            ++dangling;
+            if (!report) return;
+            std::cerr << "找不到场景: " << target << "（场景 " << graph.scenes[scene].id
+                      << " 的选项 \"" << choice.text << "\"）\n";
+        };
+
+        for (std::uint32_t s = 0; s < graph.scenes.size(); ++s) {
+            for (auto& choice : graph.choicesOf(s)) {
+                choice.setFlagIds.clear();
+                for (const auto& f : choice.setFlags) {
+                    choice.setFlagIds.push_back(graph.flags.intern(f));
+                }
+                compileCondition(choice.requirements, graph.flags, choice.condition);
+
+                if (choice.nextScene == NO_SCENE ||
+                    choice.nextScene >= graph.scenes.size() ||
+                    graph.scenes[choice.nextScene].id != choice.nextSceneId) {
+                    choice.nextScene = graph.findScene(choice.nextSceneId);
+                }
+                if (choice.nextScene == NO_SCENE) {
+                    reportDangling(s, choice, choice.nextSceneId);
+                }
+            }
+        }
+
+        // 重定向规则：按场景顺序拍平，条件编译成掩码和属性比较表
+        graph.redirects.clear();
+        for (std::uint32_t s = 0; s < graph.scenes.size(); ++s) {
+            SceneNode& node = graph.scenes[s];
+            node.redirectBegin = static_cast<std::uint32_t>(graph.redirects.size());
+            for (const auto& rule : node.redirectRules) {
+                LinkedRedirect& linked = graph.redirects.emplace_back();
+                compileCondition(rule.conditions, graph.flags, linked.condition);
+                linked.target = graph.findScene(rule.targetId);
+                if (linked.target == NO_SCENE) {
+                    ++dangling;
+                    if (report) {
+                        std::cerr << "找不到场景: " << rule.targetId << "（场景 " << node.id << " 的重定向规则）\n";
+                    }
+                }
+            }
+            node.redirectEnd = static_cast<std::uint32_t>(graph.redirects.size());
+        }
+
+        return dangling;
+    }
+
+    std::uint32_t replaceScene(StoryGraph& graph, Scene scene) {
+        std::uint32_t index = graph.findScene(scene.id);
+        if (index == NO_SCENE) {
+            // 新场景：按 ID 有序插入，选项区间先留空
+            auto pos = std::lower_bound(graph.scenes.begin(), graph.scenes.end(), scene.id,
+                [](const SceneNode& node, const std::string& id) { return node.id < id; });
+            SceneNode node;
+            node.id          = scene.id;
+            node.choiceBegin = pos == graph.scenes.end()
+                ? static_cast<std::uint32_t>(graph.choices.size())
+                : pos->choiceBegin;
+            node.choiceEnd   = node.choiceBegin;
+            index = static_cast<std::uint32_t>(pos - graph.scenes.begin());
+            graph.scenes.insert(pos, std::move(node));
+        }
+
+        SceneNode& node = graph.scenes[index];
+        node.backgroundPath = std::move(scene.backgroundPath);
+        node.dialogue       = std::move(scene.dialogue);
+        node.redirectRules  = std::move(scene.redirects);
+
+        // 把旧选项区间换成新选项，后面场景的区间整体平移
+        auto first = graph.choices.begin() + node.choiceBegin;
+        first = graph.choices.erase(first, first + (node.choiceEnd - node.choiceBegin));
+        graph.choices.insert(first,
+                             std::make_move_iterator(scene.choices.begin()),
+                             std::make_move_iterator(scene.choices.end()));
+
+        std::uint32_t oldCount = node.choiceEnd - node.choiceBegin;
+        auto newCount = static_cast<std::uint32_t>(scene.choices.size());
+        node.choiceEnd = node.choiceBegin + newCount;
+        for (std::size_t s = index + 1; s < graph.scenes.size(); ++s) {
+            graph.scenes[s].choiceBegin = graph.scenes[s].choiceBegin - oldCount + newCount;
+            graph.scenes[s].choiceEnd   = graph.scenes[s].choiceEnd - oldCount + newCount;
+        }
+
+        // 其它场景的悬空目标在启动时已经报告过，这里只报告新内容
+        linkStoryGraph(graph, false);
+        const SceneNode& replaced = graph.scenes[index];
+        for (const auto& choice : graph.choicesOf(index)) {
+            if (choice.nextScene == NO_SCENE) {
+                std::cerr << "找不到场景: " << choice.nextSceneId << "（场景 " << replaced.id
+                          << " 的选项 \"" << choice.text << "\"）\n";
+            }
+        }
+        for (std::size_t r = 0; r < replaced.redirectRules.size(); ++r) {
+            if (graph.redirects[replaced.redirectBegin + r].target == NO_SCENE) {
+                std::cerr << "找不到场景: " << replaced.redirectRules[r].targetId << "（场景 " << replaced.id
+                          << " 的重定向规则）\n";
+            }
+        }
+        return index;
+    }
+
+} // namespace CampusSim
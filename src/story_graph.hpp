@@ -0,0 +1,102 @@
+#pragma once
+
+#include "scene.hpp"
+#include "flags.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CampusSim {
+
+    // 链接后的场景：选项不再各自持有，而是引用 StoryGraph::choices 中的 [choiceBegin, choiceEnd)
+    struct SceneNode {
+        std::string id;
+        std::string backgroundPath;
+        std::string dialogue;               // 剧情文本（UTF-8，可多行）
+        std::uint32_t choiceBegin = 0;
+        std::uint32_t choiceEnd   = 0;
+        std::vector<RedirectRule> redirectRules;  // 源规则，每次链接时重新编译
+        std::uint32_t redirectBegin = 0;          // 编译好的规则在 StoryGraph::redirects 中的区间
+        std::uint32_t redirectEnd   = 0;
+    };
+
+    // 链接好的重定向规则：条件已编译，目标已解析成下标
+    struct LinkedRedirect {
+        Condition     condition;
+        std::uint32_t target = NO_SCENE;
+    };
+
+    // 连续存放的选项区间，可以直接 range-for
+    template <typename T>
+    struct ChoiceRange {
+        T* first = nullptr;
+        T* last  = nullptr;
+
+        T* begin() const { return first; }
+        T* end() const { return last; }
+        std::size_t size() const { return static_cast<std::size_t>(last - first); }
+        bool empty() const { return first == last; }
+        T& operator[](std::size_t i) const { return first[i]; }
+    };
+
+    // 扁平化、按下标互相引用的剧情图：场景和选项各是一块连续数组，
+    // 选项的目标场景在链接时就解析成下标，切换场景是 O(1)
+    struct StoryGraph {
+        std::vector<SceneNode> scenes;          // 按 ID 排序
+        std::vector<Choice> choices;            // 所有场景的选项，按场景顺序排列
+        std::vector<LinkedRedirect> redirects;  // 各场景的重定向规则，按场景顺序排列
+        FlagTable flags;
+        std::unordered_map<std::string, std::uint32_t> sceneIndex;  // 场景 ID -> 下标
+
+        // 找不到时返回 NO_SCENE
+        std::uint32_t findScene(const std::string& id) const {
+            auto it = sceneIndex.find(id);
+            return it == sceneIndex.end() ? NO_SCENE : it->second;
+        }
+
+        ChoiceRange<Choice> choicesOf(std::uint32_t scene) {
+            Choice* base = choices.data();
+            return {base + scenes[scene].choiceBegin, base + scenes[scene].choiceEnd};
+        }
+        ChoiceRange<const Choice> choicesOf(std::uint32_t scene) const {
+            const Choice* base = choices.data();
+            return {base + scenes[scene].choiceBegin, base + scenes[scene].choiceEnd};
+        }
+    };
+
+    // 把解析好的场景拍平成 StoryGraph 并链接
+    StoryGraph buildStoryGraph(std::map<std::string, Scene> scenes);
+
+    // 链接：建立 ID 索引，解析每个选项的目标场景（已有下标的保持不变）和重定向规则的目标，
+    // 驻留 flag 并编译 REQUIRES 和重定向条件。悬空的目标在这里统一报告（report 为 false 时不输出），
+    // 返回悬空的个数
+    std::size_t linkStoryGraph(StoryGraph& graph, bool report = true);
+
+    // 热重载：用重新解析的场景替换图中同 ID 的场景（没有则按 ID 顺序插入），然后重新链接。
+    // flag 只会追加驻留，已有 ID 不变，所以玩家的 FlagSet 仍然有效；
+    // 插入新场景会让其后的场景下标后移，持有场景下标的一方需要按 ID 重新定位。
+    // 只报告这个场景自己的悬空目标。返回场景的新下标
+    std::uint32_t replaceScene(StoryGraph& graph, Scene scene);
+
+    // 选了 choice 之后真正要去的场景（stats 和 flags 应已包含该选项的属性变化和 flag）：
+    // 目标场景有重定向规则时取第一条满足的规则的目标，只跳一次。
+    // 目标不存在时返回 NO_SCENE
+    inline std::uint32_t resolveNextScene(const StoryGraph& graph,
+                                          const Choice& choice,
+                                          const Stats& stats,
+                                          const FlagSet& flags) {
+        std::uint32_t target = choice.nextScene;
+        if (target == NO_SCENE) return NO_SCENE;
+        const SceneNode& node = graph.scenes[target];
+        for (std::uint32_t r = node.redirectBegin; r < node.redirectEnd; ++r) {
+            const LinkedRedirect& rule = graph.redirects[r];
+            if (conditionMet(rule.condition, stats, flags)) return rule.target;
+        }
+        return target;
+    }
+
+} // namespace CampusSim
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 不依赖图形库的文字排版：按像素宽度换行。
+// 字形度量由调用方提供（界面里是 sf::Font 的缓存，基准测试里是合成的等宽度量），
+// Metrics 需要提供：
+//   const GlyphMetrics& glyph(char32_t ch);
+//   float kerning(char32_t prev, char32_t cur);
+//   float getWhitespaceWidth() const;
+
+namespace CampusSim {
+
+    // 单个码点在某一字号下的水平度量（与 sf::Text 计算包围盒时用到的字段一致）
+    struct GlyphMetrics {
+        float advance = 0.f;
+        float left    = 0.f;   // glyph.bounds 左边缘（相对笔位）
+        float right   = 0.f;   // glyph.bounds 右边缘（相对笔位）
+    };
+
+    // 单行宽度的增量测量：逐字累加笔位和左右边界，
+    // 结果与 sf::Text::getLocalBounds().size.x 完全一致（常规字形、无描边、默认字距）
+    struct LineMeasure {
+        float    x    = 0.f;
+        float    minX = 0.f;
+        float    maxX = 0.f;
+        char32_t prev = 0;
+
+        void reset(unsigned int characterSize) {
+            x    = 0.f;
+            minX = static_cast<float>(characterSize);  // sf::Text 以字号作为 minX 初值
+            maxX = 0.f;
+            prev = 0;
+        }
+
+        float width() const { return maxX - minX; }
+
+        // 追加一个码点（不能是 '\n'）
+        template <typename Metrics>
+        void push(char32_t ch, Metrics& metrics) {
+            if (ch == U'\r') return;  // sf::Text 直接跳过 \r
+
+            x += metrics.kerning(prev, ch);
+            prev = ch;
+
+            if (ch == U' ' || ch == U'\t') {
+                minX = std::min(minX, x);
+                x += (ch == U' ') ? metrics.getWhitespaceWidth()
+                                  : metrics.getWhitespaceWidth() * 4;
+                maxX = std::max(maxX, x);
+                return;
+            }
+
+            const GlyphMetrics& g = metrics.glyph(ch);
+            minX = std::min(minX, x + g.left);
+            maxX = std::max(maxX, x + g.right);
+            x += g.advance;
+        }
+    };
+
+    // 将一段 UTF-32 文本按像素宽度自动换行。
+    // 每个码点之间都可断行（中文按字断行，英文不保留整词），
+    // 行宽用 LineMeasure 增量计算，整段为线性时间
+    template <typename Metrics>
+    std::u32string wrapText(const char32_t* input, std::size_t size,
+                            unsigned int characterSize, float maxWidth, Metrics& metrics) {
+        std::u32string result;
+        result.reserve(size + size / 16);
+
+        std::size_t lineStart = 0;  // 当前行在 result 中的起点
+        LineMeasure line;
+        line.reset(characterSize);
+
+        for (std::size_t i = 0; i < size; ++i) {
+            char32_t ch = input[i];
+
+            if (ch == U'\n') {
+                result += U'\n';
+                lineStart = result.size();
+                line.reset(characterSize);
+                continue;
+            }
+
+            LineMeasure test = line;
+            test.push(ch, metrics);
+
+            if (test.width() > maxWidth && result.size() > lineStart) {
+                result += U'\n';
+                lineStart = result.size();
+                line.reset(characterSize);
+                line.push(ch, metrics);
+            } else {
+                line = test;
+            }
+            result += ch;
+        }
+
+        return result;
+    }
+
+    // 把一段 UTF-32 文本里需要字形的码点追加到 out（字形预热用）。
+    // 与 LineMeasure::push 一致：空格、制表符和换行不取字形，跳过
+    inline void collectCodepoints(const char32_t* input, std::size_t size, std::vector<char32_t>& out) {
+        for (std::size_t i = 0; i < size; ++i) {
+            char32_t ch = input[i];
+            if (ch == U' ' || ch == U'\t' || ch == U'\n' || ch == U'\r') continue;
+            out.push_back(ch);
+        }
+    }
+
+    // 排序去重，得到码点集合
+    inline void uniqueCodepoints(std::vector<char32_t>& codepoints) {
+        std::sort(codepoints.begin(), codepoints.end());
+        codepoints.erase(std::unique(codepoints.begin(), codepoints.end()), codepoints.end());
+    }
+
+} // namespace CampusSim
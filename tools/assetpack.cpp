@@ -0,0 +1,65 @@
+// assetpack：把场景引用的所有背景图解码成 RGBA，压缩后打进一个可内存映射的资源包，
+// 游戏切场景时直接解压像素，不再解码图片
+//
+// 用法：assetpack [场景目录] [输出文件]
+//       默认为 scenes 和 assets.pack，在游戏运行目录下执行即可。
+//       解码用的是游戏本身的 sf::Image，包里的像素与直接读图片完全一致。
+//       改过图片后需要重新运行，否则游戏会对改过的图片改读散文件
+
+#include <SFML/Graphics/Image.hpp>
+
+#include "asset_archive.hpp"
+#include "scene_bundle.hpp"
+#include "story_graph.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    std::string sceneDir = (argc > 1) ? argv[1] : "scenes";
+    std::string outPath  = (argc > 2) ? argv[2] : CampusSim::ASSET_ARCHIVE_PATH;
+
+    CampusSim::StoryGraph story = CampusSim::loadStory(sceneDir);
+    if (story.scenes.empty()) {
+        std::cerr << "未加载到任何场景: " << sceneDir << "\n";
+        return 1;
+    }
+
+    std::set<std::string> paths;
+    for (const auto& scene : story.scenes) {
+        if (!scene.backgroundPath.empty()) paths.insert(scene.backgroundPath);
+    }
+
+    std::vector<CampusSim::ArchiveImage> images;
+    std::size_t pixelBytes = 0;
+    bool allLoaded = true;
+    for (const auto& path : paths) {
+        sf::Image image;
+        if (!image.loadFromFile(path)) {
+            std::cerr << "无法读取背景图 " << path << "，跳过\n";
+            allLoaded = false;
+            continue;
+        }
+
+        CampusSim::ArchiveImage entry;
+        entry.path   = path;
+        entry.width  = image.getSize().x;
+        entry.height = image.getSize().y;
+        const std::uint8_t* pixels = image.getPixelsPtr();
+        entry.pixels.assign(pixels, pixels + std::size_t(entry.width) * entry.height * 4u);
+        pixelBytes += entry.pixels.size();
+        images.push_back(std::move(entry));
+    }
+
+    if (!CampusSim::writeAssetArchive(images, outPath)) {
+        return 1;
+    }
+
+    std::cout << "已生成 " << outPath << ": " << images.size() << " 张背景, 解码后 "
+              << pixelBytes / 1024 << " KB, 资源包 "
+              << std::filesystem::file_size(outPath) / 1024 << " KB\n";
+    return allLoaded ? 0 : 1;
+}
@@ -0,0 +1,407 @@
+// campus_batch：无界面的批量蒙特卡洛模拟，统计大量独立游玩结束时的属性分布和结局分布
+//
+// 用法：campus_batch [--runs N] [--threads T] [--seed S] [--max-steps K]
+//                    [--weights 学力=2,理智=1] [--scenes 目录] [--csv 输出文件]
+//
+// 默认策略在可见选项中均匀随机；给了 --weights 时按 1 + Σ 权重×变化量 加权（至少 0.05）。
+// 限时选项视为来得及选（模拟里没有时钟）。
+
+#include "cli_args.hpp"
+#include "engine.hpp"
+#include "parallel.hpp"
+#include "rng.hpp"
+#include "scene_bundle.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CAMPUS_BATCH_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CAMPUS_BATCH_NEON 1
+#endif
+
+using namespace CampusSim;
+
+namespace {
+
+    constexpr int         HIST_BINS = STAT_MAX - STAT_MIN + 1;
+    constexpr std::size_t LANES     = 1024;  // 每批同时推进的游玩数
+
+    struct Options {
+        std::uint64_t runs     = 100000;
+        unsigned      threads  = 0;
+        std::uint64_t seed     = 20240901;
+        std::uint32_t maxSteps = 500;
+        std::string   sceneDir = "scenes";
+        std::string   csvPath;
+        bool          weighted = false;
+        Choice        weights;  // 借用 Choice 的九个 d* 字段存各属性的权重
+    };
+
+    // stat[i] = clamp(stat[i] + delta[i])，SSE2 / NEON 一次处理 4 条
+    void addClampLanes(std::int32_t* stat, const std::int32_t* delta, std::size_t n) {
+        std::size_t i = 0;
+#if defined(CAMPUS_BATCH_SSE2)
+        const __m128i lo = _mm_set1_epi32(STAT_MIN);
+        const __m128i hi = _mm_set1_epi32(STAT_MAX);
+        for (; i + 4 <= n; i += 4) {
+            __m128i v = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(stat + i)),
+                                      _mm_loadu_si128(reinterpret_cast<const __m128i*>(delta + i)));
+            // SSE2 没有 32 位 min/max，用比较 + 选择代替
+            __m128i over = _mm_cmpgt_epi32(v, hi);
+            v = _mm_or_si128(_mm_and_si128(over, hi), _mm_andnot_si128(over, v));
+            __m128i under = _mm_cmplt_epi32(v, lo);
+            v = _mm_or_si128(_mm_and_si128(under, lo), _mm_andnot_si128(under, v));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(stat + i), v);
+        }
+#elif defined(CAMPUS_BATCH_NEON)
+        const int32x4_t lo = vdupq_n_s32(STAT_MIN);
+        const int32x4_t hi = vdupq_n_s32(STAT_MAX);
+        for (; i + 4 <= n; i += 4) {
+            int32x4_t v = vaddq_s32(vld1q_s32(stat + i), vld1q_s32(delta + i));
+            vst1q_s32(stat + i, vminq_s32(vmaxq_s32(v, lo), hi));
+        }
+#endif
+        for (; i < n; ++i) {
+            stat[i] = clampStat(stat[i] + delta[i]);
+        }
+    }
+
+    // 每个选项的九项变化量，按属性分列存放（与 lane 状态同为 SoA）
+    struct ChoiceTable {
+        std::vector<std::int32_t> delta[STAT_COUNT];
+        std::vector<double> weight;
+
+        ChoiceTable(const StoryGraph& story, const Options& opt) {
+            for (int k = 0; k < STAT_COUNT; ++k) delta[k].reserve(story.choices.size());
+            weight.reserve(story.choices.size());
+
+            for (const auto& c : story.choices) {
+                double w = 1.0;
+                for (int k = 0; k < STAT_COUNT; ++k) {
+                    delta[k].push_back(c.*DELTA_FIELDS[k]);
+                    if (opt.weighted) w += static_cast<double>(opt.weights.*DELTA_FIELDS[k]) * (c.*DELTA_FIELDS[k]);
+                }
+                weight.push_back(std::max(w, 0.05));
+            }
+        }
+    };
+
+    // 所有批次合并后的统计结果
+    struct Results {
+        std::vector<std::uint64_t> statHist[STAT_COUNT];  // 下标为 值 - STAT_MIN
+        std::vector<std::uint64_t> endings;               // 无可见选项而结束，按场景下标
+        std::vector<std::uint64_t> danglings;             // 选到了悬空目标，按所在场景下标
+        std::uint64_t stepLimited = 0;                    // 达到步数上限
+        std::uint64_t steps       = 0;
+
+        explicit Results(std::size_t sceneCount)
+            : endings(sceneCount, 0), danglings(sceneCount, 0) {
+            for (auto& h : statHist) h.assign(HIST_BINS, 0);
+        }
+
+        void merge(const Results& o) {
+            for (int k = 0; k < STAT_COUNT; ++k) {
+                for (int b = 0; b < HIST_BINS; ++b) statHist[k][b] += o.statHist[k][b];
+            }
+            for (std::size_t s = 0; s < endings.size(); ++s) {
+                endings[s]   += o.endings[s];
+                danglings[s] += o.danglings[s];
+            }
+            stepLimited += o.stepLimited;
+            steps       += o.steps;
+        }
+    };
+
+    // 一批 lane 同步推进：每一步先逐条选出选项并把变化量写进 delta，
+    // 再对九个属性列整列做向量化的加法 + 夹取
+    void runBlock(const StoryGraph& story, const ChoiceTable& table, const Options& opt,
+                  std::uint32_t startScene, std::size_t lanes, std::uint64_t blockSeed,
+                  Results& out) {
+        const std::size_t words = (story.flags.size() + 63) / 64;
+
+        std::vector<std::uint32_t> scene(lanes, startScene);
+        std::vector<std::uint8_t>  alive(lanes, 1);
+        std::vector<std::uint32_t> steps(lanes, 0);
+        std::vector<std::uint64_t> flags(words * lanes, 0);  // flags[w * lanes + i]
+        std::vector<std::int32_t>  stat[STAT_COUNT];
+        std::vector<std::int32_t>  delta[STAT_COUNT];
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            stat[k].assign(lanes, 0);
+            delta[k].assign(lanes, 0);
+        }
+
+        Rng rng{blockSeed};  // 每批一个独立种子，结果与线程数无关
+        std::vector<std::uint32_t> candidates;
+        std::vector<double> cumulative;
+
+        // 第 lane 条路线是否满足条件；afterDelta 为 true 时按本步属性变化之后的值比较
+        // （重定向在选项生效之后求值，而属性要到本轮末尾才统一加上）
+        auto laneMeets = [&](const Condition& cond, std::size_t lane, bool afterDelta) {
+            for (const auto& in : cond.code) {
+                if (in.op == Condition::Op::Flags) {
+                    std::uint64_t have = in.word < words ? flags[in.word * lanes + lane] : 0;
+                    if ((in.required & ~have) | (in.forbidden & have)) return false;
+                    continue;
+                }
+                int v = stat[in.stat][lane];
+                if (afterDelta) v = clampStat(v + delta[in.stat][lane]);
+                if (!compareStat(v, in.cmp, in.value)) return false;
+            }
+            return true;
+        };
+
+        std::size_t aliveCount = lanes;
+        while (aliveCount > 0) {
+            for (int k = 0; k < STAT_COUNT; ++k) {
+                std::fill(delta[k].begin(), delta[k].end(), 0);
+            }
+
+            for (std::size_t i = 0; i < lanes; ++i) {
+                if (!alive[i]) continue;
+
+                const SceneNode& node = story.scenes[scene[i]];
+                candidates.clear();
+                cumulative.clear();
+                double total = 0.0;
+                for (std::uint32_t c = node.choiceBegin; c < node.choiceEnd; ++c) {
+                    if (!laneMeets(story.choices[c].condition, i, false)) continue;
+                    candidates.push_back(c);
+                    total += table.weight[c];
+                    cumulative.push_back(total);
+                }
+
+                if (candidates.empty()) {
+                    ++out.endings[scene[i]];
+                    alive[i] = 0;
+                    --aliveCount;
+                    continue;
+                }
+
+                double r = rng.uniform() * total;
+                std::size_t pick = static_cast<std::size_t>(
+                    std::upper_bound(cumulative.begin(), cumulative.end(), r) - cumulative.begin());
+                if (pick >= candidates.size()) pick = candidates.size() - 1;
+
+                std::uint32_t c = candidates[pick];
+                const Choice& choice = story.choices[c];
+                for (int k = 0; k < STAT_COUNT; ++k) {
+                    delta[k][i] = table.delta[k][c];
+                }
+                for (auto f : choice.setFlagIds) {
+                    flags[(f / 64) * lanes + i] |= std::uint64_t(1) << (f % 64);
+                }
+
+                std::uint32_t next = choice.nextScene;
+                if (next != NO_SCENE) {
+                    const SceneNode& target = story.scenes[next];
+                    for (std::uint32_t r = target.redirectBegin; r < target.redirectEnd; ++r) {
+                        if (laneMeets(story.redirects[r].condition, i, true)) {
+                            next = story.redirects[r].target;
+                            break;
+                        }
+                    }
+                }
+
+                ++steps[i];
+                if (next == NO_SCENE) {
+                    ++out.danglings[scene[i]];
+                    alive[i] = 0;
+                    --aliveCount;
+                } else if (steps[i] >= opt.maxSteps) {
+                    ++out.stepLimited;
+                    alive[i] = 0;
+                    --aliveCount;
+                } else {
+                    scene[i] = next;
+                }
+            }
+
+            for (int k = 0; k < STAT_COUNT; ++k) {
+                addClampLanes(stat[k].data(), delta[k].data(), lanes);
+            }
+        }
+
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            for (std::size_t i = 0; i < lanes; ++i) {
+                ++out.statHist[k][stat[k][i] - STAT_MIN];
+            }
+        }
+        for (auto s : steps) out.steps += s;
+    }
+
+    // 直方图的分位数（p 在 0~1 之间）
+    int percentile(const std::vector<std::uint64_t>& hist, std::uint64_t total, double p) {
+        std::uint64_t target = static_cast<std::uint64_t>(p * static_cast<double>(total));
+        std::uint64_t seen = 0;
+        for (int b = 0; b < HIST_BINS; ++b) {
+            seen += hist[b];
+            if (seen > target) return b + STAT_MIN;
+        }
+        return STAT_MAX;
+    }
+
+    // 按终端显示宽度补空格：ASCII 占 1 列，其余（中文）按 2 列算
+    std::string padRight(const std::string& s, std::size_t width) {
+        std::size_t shown = 0;
+        for (unsigned char ch : s) {
+            if (ch < 0x80) {
+                ++shown;
+            } else if ((ch & 0xC0) != 0x80) {
+                shown += 2;
+            }
+        }
+        return shown >= width ? s : s + std::string(width - shown, ' ');
+    }
+
+    void printUsage() {
+        std::cerr << "用法: campus_batch [--runs N] [--threads T] [--seed S] [--max-steps K]\n"
+                     "                    [--weights 学力=2,理智=1] [--scenes 目录] [--csv 输出文件]\n";
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                printUsage();
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--runs") {
+            parseNumberArg(arg, value(), opt.runs, printUsage);
+        } else if (arg == "--threads") {
+            parseNumberArg(arg, value(), opt.threads, printUsage);
+        } else if (arg == "--seed") {
+            parseNumberArg(arg, value(), opt.seed, printUsage);
+        } else if (arg == "--max-steps") {
+            parseNumberArg(arg, value(), opt.maxSteps, printUsage);
+        } else if (arg == "--weights") {
+            opt.weighted = true;
+            parseDelta(value(), opt.weights);
+        } else if (arg == "--scenes") {
+            opt.sceneDir = value();
+        } else if (arg == "--csv") {
+            opt.csvPath = value();
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (opt.runs == 0) {
+        std::cerr << "--runs 至少为 1\n";
+        printUsage();
+        return 2;
+    }
+
+    StoryGraph story = loadStory(opt.sceneDir);
+    std::uint32_t start = story.findScene("start");
+    if (start == NO_SCENE) {
+        std::cerr << "缺少起始场景 ID: start\n";
+        return 1;
+    }
+    if (opt.maxSteps == 0) opt.maxSteps = 1;
+
+    ChoiceTable table(story, opt);
+    Results total(story.scenes.size());
+    std::mutex totalMutex;
+
+    const std::size_t blocks = static_cast<std::size_t>((opt.runs + LANES - 1) / LANES);
+    const unsigned threads = opt.threads ? opt.threads : defaultThreadCount();
+
+    auto t0 = std::chrono::steady_clock::now();
+    parallelFor(blocks, threads, [&](std::size_t b) {
+        std::size_t lanes = static_cast<std::size_t>(
+            std::min<std::uint64_t>(LANES, opt.runs - static_cast<std::uint64_t>(b) * LANES));
+        Results local(story.scenes.size());
+        runBlock(story, table, opt, start, lanes, opt.seed ^ (0xA24BAED4963EE407ull * (b + 1)), local);
+
+        std::lock_guard<std::mutex> lock(totalMutex);
+        total.merge(local);
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::cout << "模拟 " << opt.runs << " 次游玩，" << threads << " 线程，用时 "
+              << std::fixed << std::setprecision(3) << seconds << " 秒（"
+              << std::setprecision(0) << (seconds > 0 ? opt.runs / seconds : 0.0) << " 次/秒，平均 "
+              << std::setprecision(2) << static_cast<double>(total.steps) / static_cast<double>(opt.runs)
+              << " 步）\n\n";
+
+    std::cout << padRight("属性", 10) << "    均值  最小    P5   P50   P95  最大\n";
+    for (int k = 0; k < STAT_COUNT; ++k) {
+        const auto& hist = total.statHist[k];
+        double sum = 0;
+        int lo = STAT_MAX, hi = STAT_MIN;
+        for (int b = 0; b < HIST_BINS; ++b) {
+            if (!hist[b]) continue;
+            sum += static_cast<double>(hist[b]) * (b + STAT_MIN);
+            lo = std::min(lo, b + STAT_MIN);
+            hi = std::max(hi, b + STAT_MIN);
+        }
+        std::cout << padRight(STAT_NAMES[k], 10)
+                  << std::setw(8) << std::setprecision(2) << sum / static_cast<double>(opt.runs)
+                  << std::setw(6) << lo
+                  << std::setw(6) << percentile(hist, opt.runs, 0.05)
+                  << std::setw(6) << percentile(hist, opt.runs, 0.50)
+                  << std::setw(6) << percentile(hist, opt.runs, 0.95)
+                  << std::setw(6) << hi << "\n";
+    }
+
+    struct EndingRow {
+        std::string label;
+        std::uint64_t count;
+    };
+    std::vector<EndingRow> rows;
+    for (std::size_t s = 0; s < story.scenes.size(); ++s) {
+        if (total.endings[s]) rows.push_back({story.scenes[s].id, total.endings[s]});
+        if (total.danglings[s]) rows.push_back({story.scenes[s].id + "（目标不存在）", total.danglings[s]});
+    }
+    if (total.stepLimited) rows.push_back({"（达到步数上限）", total.stepLimited});
+    std::sort(rows.begin(), rows.end(), [](const EndingRow& a, const EndingRow& b) {
+        return a.count != b.count ? a.count > b.count : a.label < b.label;
+    });
+
+    std::cout << "\n结局分布:\n";
+    for (const auto& row : rows) {
+        std::cout << std::setw(10) << row.count << "  " << std::setw(6) << std::setprecision(2)
+                  << 100.0 * static_cast<double>(row.count) / static_cast<double>(opt.runs)
+                  << "%  " << row.label << "\n";
+    }
+
+    if (!opt.csvPath.empty()) {
+        std::ofstream csv(opt.csvPath);
+        if (!csv) {
+            std::cerr << "无法写入 " << opt.csvPath << "\n";
+            return 1;
+        }
+        csv << "kind,key,value,count\n";
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            for (int b = 0; b < HIST_BINS; ++b) {
+                if (total.statHist[k][b]) {
+                    csv << "stat," << STAT_NAMES[k] << "," << (b + STAT_MIN) << "," << total.statHist[k][b] << "\n";
+                }
+            }
+        }
+        for (const auto& row : rows) {
+            csv << "ending," << row.label << ",," << row.count << "\n";
+        }
+    }
+
+    return 0;
+}
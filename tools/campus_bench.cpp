@@ -0,0 +1,510 @@
+// campus_bench：热点函数的微基准，以及合成大规模剧情的生成器
+//
+// 用法：campus_bench [--json 输出文件] [--baseline 基线文件] [--threshold 百分比]
+//                    [--filter 名字片段] [--min-time 毫秒]
+//       campus_bench gen <输出目录> [--scenes N] [--fanout F] [--flags K] [--flag-density P] [--seed S]
+//
+// 结果写成 JSON（每项为每次操作的纳秒数，取多轮的中位数）。给了 --baseline 时逐项对比，
+// 任一项比基线慢超过阈值（默认 10%）就以状态 1 退出，方便在 CI 里发现性能回退。
+// gen 按现有 .scene 格式写出合成剧情（每 1000 个场景一个子目录），可直接给 scenec、
+// campus_explore 或游戏本身使用。
+
+#include "cli_args.hpp"
+#include "engine.hpp"
+#include "replay.hpp"
+#include "rng.hpp"
+#include "scene.hpp"
+#include "story_graph.hpp"
+#include "text_layout.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace CampusSim;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    // ----------------- 合成剧情生成器 -----------------
+
+    struct GenOptions {
+        std::size_t   scenes      = 10000;
+        std::size_t   fanout      = 3;     // 每个场景的选项数
+        std::size_t   flags       = 64;    // flag 池大小
+        double        flagDensity = 0.2;   // 每个选项设置 / 要求一个 flag 的概率
+        std::uint64_t seed        = 1;
+    };
+
+    const char* const CJK_WORDS[] = {
+        "今天", "你站在", "南开大学", "的校门口", "准备开始", "新的校园生活", "图书馆里", "人很多",
+        "食堂的", "煎饼果子", "还是那么好吃", "辅导员", "通知大家", "下午开会", "操场上", "有人在跑步",
+    };
+    const char* const LATIN_WORDS[] = {
+        "the", "quick", "campus", "lecture", "starts", "at", "eight", "sharp", "and", "everyone",
+        "is", "late", "again", "because", "breakfast", "queue",
+    };
+
+    std::string sceneId(std::size_t i) {
+        return i == 0 ? std::string("start") : "s" + std::to_string(i);
+    }
+
+    std::string randomSentence(Rng& rng, std::size_t words) {
+        std::string out;
+        for (std::size_t w = 0; w < words; ++w) {
+            if (rng.chance(0.25)) {
+                if (!out.empty()) out += ' ';
+                out += LATIN_WORDS[rng.below(std::size(LATIN_WORDS))];
+            } else {
+                out += CJK_WORDS[rng.below(std::size(CJK_WORDS))];
+            }
+        }
+        return out + "。";
+    }
+
+    // 写出一个场景；约 1% 的场景没有选项，作为结局
+    void writeSyntheticScene(std::ostream& out, std::size_t i, const GenOptions& opt, Rng& rng) {
+        out << "ID: " << sceneId(i) << "\n";
+        out << "BG: assets/bg" << (i % 16) << ".png\n\n";
+
+        out << "TEXT:\n";
+        std::size_t lines = 2 + rng.below(3);
+        for (std::size_t l = 0; l < lines; ++l) {
+            out << randomSentence(rng, 4 + rng.below(8)) << "\n";
+        }
+        out << "ENDTEXT\n\n";
+
+        if (i != 0 && rng.chance(0.01)) return;
+
+        out << "CHOICE:\n";
+        for (std::size_t c = 0; c < opt.fanout; ++c) {
+            out << randomSentence(rng, 2 + rng.below(3)) << " | ";
+
+            std::size_t deltas = 1 + rng.below(2);
+            for (std::size_t d = 0; d < deltas; ++d) {
+                if (d) out << ",";
+                int value = static_cast<int>(rng.below(5)) - 2;
+                out << STAT_NAMES[rng.below(STAT_COUNT)] << "=" << (value >= 0 ? "+" : "") << value;
+            }
+
+            // 大多数选项往后走，少数跳回前面形成环
+            std::size_t next = rng.chance(0.9)
+                ? (i + 1 + rng.below(50)) % opt.scenes
+                : rng.below(opt.scenes);
+            out << " | " << sceneId(next) << " | ";
+
+            std::string flags;
+            if (opt.flags && rng.chance(opt.flagDensity)) flags = "f" + std::to_string(rng.below(opt.flags));
+            if (rng.chance(0.05)) flags += (flags.empty() ? "" : ",") + std::string("timed10");
+            out << (flags.empty() ? "0" : flags) << " | ";
+
+            // 第一个选项不设条件，保证每个场景都能走下去
+            if (c != 0 && opt.flags && rng.chance(opt.flagDensity)) {
+                out << "f" << rng.below(opt.flags);
+            } else {
+                out << "0";
+            }
+            out << "\n";
+        }
+        out << "ENDCHOICE\n";
+    }
+
+    bool generateStory(const fs::path& dir, const GenOptions& opt) {
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        if (ec) {
+            std::cerr << "无法创建目录 " << dir << ": " << ec.message() << "\n";
+            return false;
+        }
+
+        Rng rng{opt.seed};
+        for (std::size_t i = 0; i < opt.scenes; ++i) {
+            char sub[24];  // 最多 20 位数字
+            std::snprintf(sub, sizeof(sub), "%04zu", i / 1000);
+            fs::path subdir = dir / sub;
+            if (i % 1000 == 0) fs::create_directories(subdir, ec);
+
+            std::ofstream out(subdir / (sceneId(i) + ".scene"));
+            if (!out) {
+                std::cerr << "无法写入 " << (subdir / (sceneId(i) + ".scene")) << "\n";
+                return false;
+            }
+            writeSyntheticScene(out, i, opt, rng);
+        }
+        return true;
+    }
+
+    // ----------------- 计时 -----------------
+
+    struct BenchResult {
+        std::string   name;
+        double        nsPerOp    = 0.0;
+        std::uint64_t iterations = 0;  // 每轮的次数
+    };
+
+    // 防止编译器把被测代码整个优化掉
+    volatile std::size_t benchSink = 0;
+
+    constexpr int BENCH_ROUNDS = 5;
+
+    // 先把单轮的次数调到至少 minTime，再跑 BENCH_ROUNDS 轮取中位数
+    template <typename Fn>
+    BenchResult measure(const std::string& name, double minTimeMs, Fn&& op) {
+        using Clock = std::chrono::steady_clock;
+        auto runBatch = [&](std::uint64_t n) {
+            auto t0 = Clock::now();
+            for (std::uint64_t i = 0; i < n; ++i) op();
+            return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        };
+
+        std::uint64_t n = 1;
+        double elapsed = runBatch(n);
+        while (elapsed < minTimeMs * 1e6) {
+            double scale = elapsed > 0 ? std::min(10.0, 1.2 * minTimeMs * 1e6 / elapsed) : 10.0;
+            n = std::max<std::uint64_t>(n + 1, static_cast<std::uint64_t>(static_cast<double>(n) * scale));
+            elapsed = runBatch(n);
+        }
+
+        std::vector<double> perOp;
+        for (int r = 0; r < BENCH_ROUNDS; ++r) perOp.push_back(runBatch(n) / static_cast<double>(n));
+        std::sort(perOp.begin(), perOp.end());
+        return {name, perOp[BENCH_ROUNDS / 2], n};
+    }
+
+    // ----------------- 被测对象的准备 -----------------
+
+    // 合成的字形度量：CJK 一个字号宽，其余约半个字号。和界面里的 GlyphMetricsCache
+    // 一样按码点查表缓存，测的是换行算法本身而不是字体光栅化
+    class SyntheticMetrics {
+    public:
+        explicit SyntheticMetrics(unsigned int characterSize)
+            : size_(static_cast<float>(characterSize)) {}
+
+        float getWhitespaceWidth() const { return size_ * 0.3f; }
+
+        const GlyphMetrics& glyph(char32_t ch) {
+            auto it = glyphs_.find(ch);
+            if (it != glyphs_.end()) return it->second;
+
+            GlyphMetrics m;
+            m.advance = ch >= 0x2E80 ? size_ : size_ * 0.55f;
+            m.left    = size_ * 0.05f;
+            m.right   = m.advance - size_ * 0.05f;
+            return glyphs_.emplace(ch, m).first->second;
+        }
+
+        float kerning(char32_t prev, char32_t cur) {
+            if (prev == 0 || cur == 0) return 0.f;
+            std::uint64_t key = (static_cast<std::uint64_t>(prev) << 32) | cur;
+            auto it = kernings_.find(key);
+            if (it != kernings_.end()) return it->second;
+            return kernings_.emplace(key, (prev < 0x80 && cur < 0x80) ? -0.5f : 0.f).first->second;
+        }
+
+    private:
+        float size_;
+        std::unordered_map<char32_t, GlyphMetrics> glyphs_;
+        std::unordered_map<std::uint64_t, float> kernings_;
+    };
+
+    std::u32string utf8ToUtf32(const std::string& s) {
+        std::u32string out;
+        for (std::size_t i = 0; i < s.size();) {
+            unsigned char c = static_cast<unsigned char>(s[i]);
+            int extra = c < 0x80 ? 0 : c < 0xE0 ? 1 : c < 0xF0 ? 2 : 3;
+            char32_t cp = extra == 0 ? c : extra == 1 ? (c & 0x1F) : extra == 2 ? (c & 0x0F) : (c & 0x07);
+            for (int k = 1; k <= extra && i + k < s.size(); ++k) {
+                cp = (cp << 6) | (static_cast<unsigned char>(s[i + k]) & 0x3F);
+            }
+            out += cp;
+            i += 1 + extra;
+        }
+        return out;
+    }
+
+    std::u32string longText(bool cjk, std::size_t words) {
+        Rng rng{7};
+        std::string out;
+        for (std::size_t w = 0; w < words; ++w) {
+            if (cjk) {
+                out += CJK_WORDS[rng.below(std::size(CJK_WORDS))];
+            } else {
+                if (!out.empty()) out += ' ';
+                out += LATIN_WORDS[rng.below(std::size(LATIN_WORDS))];
+            }
+            if (w % 40 == 39) out += '\n';
+        }
+        return utf8ToUtf32(out);
+    }
+
+    // ----------------- JSON -----------------
+
+    void writeJson(std::ostream& out, const std::vector<BenchResult>& results) {
+        out << "{\n  \"version\": 1,\n  \"benchmarks\": [\n";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            out << "    {\"name\": \"" << results[i].name << "\", \"ns_per_op\": "
+                << std::fixed << std::setprecision(2) << results[i].nsPerOp
+                << ", \"iterations\": " << results[i].iterations << "}"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+    // 只认 writeJson 写出的格式：逐个找 "name" 和紧随其后的 "ns_per_op"
+    bool readBaseline(const std::string& path, std::unordered_map<std::string, double>& out) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "无法读取基线 " << path << "\n";
+            return false;
+        }
+        std::stringstream buf;
+        buf << in.rdbuf();
+        const std::string text = buf.str();
+
+        const std::string nameKey = "\"name\": \"";
+        const std::string valueKey = "\"ns_per_op\": ";
+        for (std::size_t pos = text.find(nameKey); pos != std::string::npos; pos = text.find(nameKey, pos)) {
+            pos += nameKey.size();
+            std::size_t end = text.find('"', pos);
+            std::size_t value = text.find(valueKey, end);
+            if (end == std::string::npos || value == std::string::npos) break;
+            out[text.substr(pos, end - pos)] = std::strtod(text.c_str() + value + valueKey.size(), nullptr);
+        }
+        return true;
+    }
+
+    void printUsage() {
+        std::cerr << "用法: campus_bench [--json 输出文件] [--baseline 基线文件] [--threshold 百分比]\n"
+                     "                    [--filter 名字片段] [--min-time 毫秒]\n"
+                     "       campus_bench gen <输出目录> [--scenes N] [--fanout F] [--flags K]\n"
+                     "                        [--flag-density P] [--seed S]\n";
+    }
+
+    int runGenerator(int argc, char** argv) {
+        if (argc < 3) {
+            printUsage();
+            return 2;
+        }
+        GenOptions opt;
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string arg = argv[i];
+            std::string value = argv[i + 1];
+            if (arg == "--scenes") parseNumberArg(arg, value, opt.scenes, printUsage);
+            else if (arg == "--fanout") parseNumberArg(arg, value, opt.fanout, printUsage);
+            else if (arg == "--flags") parseNumberArg(arg, value, opt.flags, printUsage);
+            else if (arg == "--flag-density") parseNumberArg(arg, value, opt.flagDensity, printUsage);
+            else if (arg == "--seed") parseNumberArg(arg, value, opt.seed, printUsage);
+            else {
+                printUsage();
+                return 2;
+            }
+        }
+        if (opt.scenes == 0) opt.scenes = 1;
+        if (opt.fanout == 0) opt.fanout = 1;
+
+        auto t0 = std::chrono::steady_clock::now();
+        if (!generateStory(argv[2], opt)) return 1;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "已生成 " << opt.scenes << " 个场景到 " << argv[2] << "（每场景 " << opt.fanout
+                  << " 个选项，" << opt.flags << " 个 flag，密度 " << opt.flagDensity << "），用时 "
+                  << std::fixed << std::setprecision(2) << seconds << " 秒\n";
+        return 0;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "gen") {
+        return runGenerator(argc, argv);
+    }
+
+    std::string jsonPath, baselinePath, filter;
+    double threshold = 10.0;
+    double minTimeMs = 50.0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        if (arg == "--json") jsonPath = argv[++i];
+        else if (arg == "--baseline") baselinePath = argv[++i];
+        else if (arg == "--threshold") parseNumberArg(arg, argv[++i], threshold, printUsage);
+        else if (arg == "--filter") filter = argv[++i];
+        else if (arg == "--min-time") parseNumberArg(arg, argv[++i], minTimeMs, printUsage);
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    // 基准用的合成剧情写到临时目录，结束时删掉
+    fs::path workDir = fs::temp_directory_path() /
+        ("campus_bench_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    GenOptions small;
+    small.scenes = 2000;
+    small.fanout = 6;
+    small.flags = 32;
+    small.flagDensity = 0.5;
+    if (!generateStory(workDir, small)) return 1;
+
+    std::vector<BenchResult> results;
+    auto wanted = [&](const std::string& name) {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    };
+    auto bench = [&](const std::string& name, auto&& op) {
+        if (!wanted(name)) return;
+        results.push_back(measure(name, minTimeMs, op));
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << results.back().nsPerOp << " ns/op\n" << std::flush;
+    };
+
+    // 1) 解析
+    {
+        const std::string deltaLine = "体质=-1,学力=+2,理智=+1,experience=+3";
+        bench("parse_delta", [&] {
+            Choice c;
+            parseDelta(deltaLine, c);
+            benchSink = benchSink + static_cast<std::size_t>(c.dStudy);
+        });
+
+        const std::string choiceLine =
+            "去参加科研说明会 | experience=+1,study=+2 | research_intro | join_research,timed10 | research_invite";
+        Scene scratch;
+        bench("parse_choice_definition", [&] {
+            scratch.choices.clear();
+            parseChoiceDefinition(choiceLine, scratch);
+            benchSink = benchSink + scratch.choices.size();
+        });
+
+        fs::path oneFile = workDir / "0000" / "s1.scene";
+        bench("load_scene_file", [&] {
+            Scene scene;
+            loadSceneFile(oneFile, scene);
+            benchSink = benchSink + scene.choices.size();
+        });
+
+        bench("load_scenes_2k", [&] {
+            auto scenes = loadScenes(workDir.string());
+            benchSink = benchSink + scenes.size();
+        });
+    }
+
+    // 2) 换行（对话框宽度约 980 像素，字号 20）
+    {
+        SyntheticMetrics metrics(20);
+        const std::u32string cjk = longText(true, 400);
+        const std::u32string latin = longText(false, 400);
+        bench("wrap_text_cjk", [&] {
+            auto wrapped = wrapText(cjk.data(), cjk.size(), 20, 980.f, metrics);
+            benchSink = benchSink + wrapped.size();
+        });
+        bench("wrap_text_latin", [&] {
+            auto wrapped = wrapText(latin.data(), latin.size(), 20, 980.f, metrics);
+            benchSink = benchSink + wrapped.size();
+        });
+    }
+
+    // 3) 引擎：可见选项过滤和完整的场景切换
+    {
+        StoryGraph story = buildStoryGraph(loadScenes(workDir.string()));
+        Engine engine(story);
+        engine.start("start");
+
+        // 先随便走几步，让 flags 不为空
+        std::vector<std::size_t> visible;
+        for (int step = 0; step < 200; ++step) {
+            engine.visibleChoices(visible);
+            if (visible.empty()) engine.start("start");
+            else engine.choose(visible[static_cast<std::size_t>(step) % visible.size()]);
+        }
+
+        bench("visible_choices", [&] {
+            engine.visibleChoices(visible);
+            benchSink = benchSink + visible.size();
+        });
+
+        std::size_t step = 0;
+        bench("scene_transition", [&] {
+            engine.visibleChoices(visible);
+            if (visible.empty()) {
+                engine.start("start");
+                return;
+            }
+            auto outcome = engine.choose(visible[++step % visible.size()]);
+            benchSink = benchSink + (outcome.sceneChanged ? 1u : 0u);
+        });
+
+        // 端到端：回放录好的会话（每份 40 次选择，其间若干帧），逐步校验属性和 flags
+        Rng rng{3};
+        std::vector<std::vector<std::uint8_t>> sessions(256);
+        for (auto& log : sessions) {
+            engine.start("start");
+            ReplayRecorder recorder;
+            recorder.openInMemory(engine.snapshot());
+            for (int choice = 0; choice < 40; ++choice) {
+                for (std::size_t f = 0; f < 1 + rng.below(8); ++f) engine.advance(recorder.frame(1.f / 60.f));
+                engine.visibleChoices(visible);
+                if (visible.empty()) break;
+                std::size_t index = visible[rng.below(visible.size())];
+                const std::string from = engine.currentScene().id;
+                engine.choose(index);
+                recorder.choice(static_cast<std::uint32_t>(index), from, engine);
+            }
+            log = recorder.take();
+        }
+
+        std::size_t session = 0;
+        bench("replay_session", [&] {
+            const auto& log = sessions[session++ % sessions.size()];
+            ReplayResult result = replaySession(story, log.data(), log.size());
+            benchSink = benchSink + result.choices;
+        });
+    }
+
+    std::error_code ec;
+    fs::remove_all(workDir, ec);
+
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        if (!out) {
+            std::cerr << "无法写入 " << jsonPath << "\n";
+            return 1;
+        }
+        writeJson(out, results);
+    }
+
+    if (baselinePath.empty()) return 0;
+
+    std::unordered_map<std::string, double> baseline;
+    if (!readBaseline(baselinePath, baseline)) return 1;
+
+    int regressions = 0;
+    std::cout << "\n与基线对比（阈值 " << threshold << "%）:\n";
+    for (const auto& r : results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0.0) {
+            std::cout << "  " << std::left << std::setw(28) << r.name << std::right << "  （基线中没有）\n";
+            continue;
+        }
+        double change = (r.nsPerOp - it->second) / it->second * 100.0;
+        bool regressed = change > threshold;
+        regressions += regressed ? 1 : 0;
+        std::cout << "  " << std::left << std::setw(28) << r.name << std::right
+                  << std::setw(12) << std::setprecision(1) << it->second << " -> "
+                  << std::setw(12) << r.nsPerOp << " ns/op  "
+                  << std::showpos << std::setw(7) << change << std::noshowpos << "%"
+                  << (regressed ? "  变慢" : "") << "\n";
+    }
+    return regressions ? 1 : 0;
+}
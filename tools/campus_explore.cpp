@@ -0,0 +1,696 @@
+// campus_explore：从 start 出发穷举所有可达的（场景, 属性, flags）状态，
+// 报告可达结局、不可达场景和永远不会显示的选项
+//
+// 用法：campus_explore [--scenes 目录] [--threads T] [--start 场景ID] [--max-states N]
+//       campus_explore --solve 学力=1,名誉=1 [--keep 理智>=0] [--require 理智>=3] [--top N] ...
+//
+// --solve 切换到求最优路线模式：按给定权重最大化（负权重则最小化）结局属性，
+// --keep 要求路线上每一步都满足，--require 只要求结局满足，输出结局属性的 Pareto 前沿。
+//
+// 限时选项按“来得及选”和“已超时”两种情况都考虑：来得及选时它是一条普通的边；
+// 全部超时后如果没有别的可见选项，就记作该场景的超时结局。
+
+#include "cli_args.hpp"
+#include "engine.hpp"
+#include "parallel.hpp"
+#include "scene_bundle.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace CampusSim;
+
+namespace {
+
+    struct Options {
+        std::string   sceneDir  = "scenes";
+        std::string   start     = "start";
+        unsigned      threads   = 0;
+        std::uint64_t maxStates = 20000000;
+
+        // 求解模式
+        bool          solve = false;
+        Choice        objective;  // 借用 Choice 的九个 d* 字段存各属性的权重
+        std::string   keep;       // 例如 "理智>=0,体质>=-5"
+        std::string   require;
+        std::size_t   top = 20;
+    };
+
+    static_assert(STAT_MIN >= -128 && STAT_MAX <= 127, "属性编码为 1 字节，范围超出需要改 StateCodec");
+
+    // 状态的紧凑编码：场景下标 4 字节 + 九项属性各 1 字节（夹取后在 [-100, 100]）+ flags 位图。
+    // 同一个剧情里长度固定，直接当作哈希集合的键
+
+    class StateCodec {
+    public:
+        explicit StateCodec(const StoryGraph& story)
+            : flagWords_((story.flags.size() + 63) / 64) {}
+
+        std::size_t size() const { return 4 + STAT_COUNT + flagWords_ * 8; }
+
+        std::string encode(std::uint32_t scene, const Stats& stats, const FlagSet& flags) const {
+            std::string key(size(), '\0');
+            char* p = &key[0];
+            std::memcpy(p, &scene, 4);
+            for (int k = 0; k < STAT_COUNT; ++k) {
+                p[4 + k] = static_cast<char>(static_cast<std::int8_t>(stats.*STAT_FIELDS[k]));
+            }
+            const auto& words = flags.words();
+            for (std::size_t w = 0; w < words.size() && w < flagWords_; ++w) {
+                std::memcpy(p + 4 + STAT_COUNT + w * 8, &words[w], 8);
+            }
+            return key;
+        }
+
+        void decode(const std::string& key, std::uint32_t& scene, Stats& stats, FlagSet& flags) const {
+            const char* p = key.data();
+            std::memcpy(&scene, p, 4);
+            for (int k = 0; k < STAT_COUNT; ++k) {
+                stats.*STAT_FIELDS[k] = static_cast<std::int8_t>(p[4 + k]);
+            }
+            flags.clear();
+            for (std::size_t w = 0; w < flagWords_; ++w) {
+                std::uint64_t bits = 0;
+                std::memcpy(&bits, p + 4 + STAT_COUNT + w * 8, 8);
+                for (unsigned b = 0; bits; ++b, bits >>= 1) {
+                    if (bits & 1u) flags.set(static_cast<std::uint32_t>(w * 64 + b));
+                }
+            }
+        }
+
+    private:
+        std::size_t flagWords_;
+    };
+
+    // 分片加锁的已访问集合：按哈希选分片，线程之间很少抢同一把锁
+    class VisitedSet {
+    public:
+        static constexpr std::size_t SHARDS = 64;
+
+        // 新插入返回 true
+        bool insert(const std::string& key) {
+            std::size_t h = std::hash<std::string>{}(key);
+            Shard& shard = shards_[(h >> 7) % SHARDS];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (!shard.keys.insert(key).second) return false;
+            count_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // 不加锁，探索进行中也可以读（用于 --max-states 上限）
+        std::size_t size() const { return count_.load(std::memory_order_relaxed); }
+
+    private:
+        struct Shard {
+            std::mutex mutex;
+            std::unordered_set<std::string> keys;
+        };
+        Shard shards_[SHARDS];
+        std::atomic<std::size_t> count_{0};
+    };
+
+    // 并发写入的“出现过”标记（只会从 0 变成 1）
+    class SeenMarks {
+    public:
+        explicit SeenMarks(std::size_t n)
+            : marks_(new std::atomic<std::uint8_t>[n]), size_(n) {
+            for (std::size_t i = 0; i < n; ++i) marks_[i].store(0, std::memory_order_relaxed);
+        }
+
+        void mark(std::size_t i) {
+            if (!marks_[i].load(std::memory_order_relaxed)) marks_[i].store(1, std::memory_order_relaxed);
+        }
+        bool test(std::size_t i) const { return marks_[i].load(std::memory_order_relaxed) != 0; }
+        std::size_t size() const { return size_; }
+
+    private:
+        std::unique_ptr<std::atomic<std::uint8_t>[]> marks_;
+        std::size_t size_;
+    };
+
+    // 按结局场景累计的状态数和属性范围
+    struct EndingInfo {
+        std::uint64_t states = 0;
+        Stats lo;
+        Stats hi;
+
+        void add(const Stats& s) {
+            if (states == 0) {
+                lo = hi = s;
+            } else {
+                for (int k = 0; k < STAT_COUNT; ++k) {
+                    lo.*STAT_FIELDS[k] = std::min(lo.*STAT_FIELDS[k], s.*STAT_FIELDS[k]);
+                    hi.*STAT_FIELDS[k] = std::max(hi.*STAT_FIELDS[k], s.*STAT_FIELDS[k]);
+                }
+            }
+            ++states;
+        }
+
+        void merge(const EndingInfo& o) {
+            if (o.states == 0) return;
+            if (states == 0) {
+                *this = o;
+                return;
+            }
+            for (int k = 0; k < STAT_COUNT; ++k) {
+                lo.*STAT_FIELDS[k] = std::min(lo.*STAT_FIELDS[k], o.lo.*STAT_FIELDS[k]);
+                hi.*STAT_FIELDS[k] = std::max(hi.*STAT_FIELDS[k], o.hi.*STAT_FIELDS[k]);
+            }
+            states += o.states;
+        }
+    };
+
+    struct Endings {
+        std::vector<EndingInfo> stuck;     // 没有任何可见选项
+        std::vector<EndingInfo> timedOut;  // 限时选项全部超时后没有可见选项
+        std::vector<EndingInfo> dangling;  // 选了目标不存在的选项，按选项下标
+
+        Endings(std::size_t scenes, std::size_t choices)
+            : stuck(scenes), timedOut(scenes), dangling(choices) {}
+
+        void merge(const Endings& o) {
+            for (std::size_t i = 0; i < stuck.size(); ++i) {
+                stuck[i].merge(o.stuck[i]);
+                timedOut[i].merge(o.timedOut[i]);
+            }
+            for (std::size_t i = 0; i < dangling.size(); ++i) dangling[i].merge(o.dangling[i]);
+        }
+    };
+
+    std::string describeRange(const EndingInfo& info) {
+        std::string out;
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            int lo = info.lo.*STAT_FIELDS[k];
+            int hi = info.hi.*STAT_FIELDS[k];
+            if (lo == 0 && hi == 0) continue;
+            if (!out.empty()) out += " ";
+            out += STAT_NAMES[k];
+            out += "=" + std::to_string(lo);
+            if (hi != lo) out += "~" + std::to_string(hi);
+        }
+        return out.empty() ? "属性全为 0" : out;
+    }
+
+    // ----------------- 求解模式 -----------------
+
+    // 属性的比较方向：Higher 越大越好，Lower 越小越好，Exact 两个方向都关心
+    enum class Direction { Ignore, Higher, Lower, Exact };
+
+    struct StatBound {
+        int  stat  = 0;
+        bool atLeast = true;  // true 为 >=，false 为 <=
+        int  value = 0;
+
+        bool holds(const Stats& s) const {
+            int v = s.*STAT_FIELDS[stat];
+            return atLeast ? v >= value : v <= value;
+        }
+    };
+
+    // "理智>=0,体质<=5"；格式不对时报告并返回 false
+    bool parseBounds(const std::string& s, std::vector<StatBound>& out) {
+        for (const auto& item : split(s, ',')) {
+            std::string text = trim(item);
+            if (text.empty()) continue;
+
+            std::size_t op = text.find(">=");
+            bool atLeast = true;
+            if (op == std::string::npos) {
+                op = text.find("<=");
+                atLeast = false;
+            }
+            StatBound bound;
+            bound.atLeast = atLeast;
+            bound.stat = op == std::string::npos ? -1 : findStatKey(trimView(std::string_view(text).substr(0, op)));
+            if (bound.stat < 0) {
+                std::cerr << "无法解析属性条件: " << text << "\n";
+                return false;
+            }
+            try {
+                bound.value = std::stoi(text.substr(op + 2));
+            } catch (...) {
+                std::cerr << "无法解析属性条件: " << text << "\n";
+                return false;
+            }
+            out.push_back(bound);
+        }
+        return true;
+    }
+
+    bool allHold(const std::vector<StatBound>& bounds, const Stats& s) {
+        for (const auto& b : bounds) {
+            if (!b.holds(s)) return false;
+        }
+        return true;
+    }
+
+    void addDirection(Direction& d, Direction want) {
+        if (d == Direction::Ignore) d = want;
+        else if (d != want) d = Direction::Exact;
+    }
+
+    // a 在所有关心的属性上都不比 b 差
+    bool dominates(const Stats& a, const Stats& b, const Direction (&dirs)[STAT_COUNT]) {
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            int x = a.*STAT_FIELDS[k];
+            int y = b.*STAT_FIELDS[k];
+            switch (dirs[k]) {
+            case Direction::Ignore: break;
+            case Direction::Higher: if (x < y) return false; break;
+            case Direction::Lower:  if (x > y) return false; break;
+            case Direction::Exact:  if (x != y) return false; break;
+            }
+        }
+        return true;
+    }
+
+    // 搜索中的一个标签：到达某（场景, flags）时的属性，以及怎么走到这里的
+    struct Label {
+        std::uint32_t scene;
+        Stats stats;
+        FlagSet flags;
+        std::uint32_t parent;  // 上一个标签，起点为 NO_LABEL
+        std::uint32_t choice;  // 从 parent 走过来选的选项
+        bool alive = true;     // 被同一（场景, flags）下更好的标签支配后置 false
+    };
+
+    constexpr std::uint32_t NO_LABEL = 0xFFFFFFFFu;
+
+    // 一条走到结局的路线
+    struct Route {
+        std::uint32_t label;       // 结局前最后一个标签
+        std::uint32_t finalChoice; // 走向悬空目标的选项，其它结局为 NO_LABEL
+        Stats stats;               // 结局时的属性
+        std::string ending;
+    };
+
+    // 剧情条件读到的属性一律按 Exact 比较。条件对属性不单调：<= 是上界，== / != 两头都有，
+    // 重定向满足与否去的是不同场景；即使只有 >=，多出来的可见选项也会让较差的标签
+    // 走不到“没有可选项”的结局。只有这些属性也完全相同，两个标签后续的选项和去向才一致
+    void addConditionStats(const Condition& cond, Direction (&dirs)[STAT_COUNT]) {
+        for (const auto& in : cond.code) {
+            if (in.op == Condition::Op::Stat) dirs[in.stat] = Direction::Exact;
+        }
+    }
+
+    // 带支配剪枝的标签修正搜索（多目标 DP）：同一（场景, flags）下，
+    // 若已有标签在所有关心的属性上都不差，新标签的任何后续都不会更好，直接丢弃。
+    // 夹取是单调的（a >= b 则 clamp(a+d) >= clamp(b+d)）；flags（包括 !flag 条件）在同一个桶里完全相同，
+    // 条件读到的属性按 Exact 比较（见 addConditionStats），所以选项可见性和重定向都一致，剪枝是安全的
+    int solve(const StoryGraph& story, std::uint32_t startScene, const Options& opt) {
+        std::vector<StatBound> keep, require;
+        if (!parseBounds(opt.keep, keep) || !parseBounds(opt.require, require)) return 2;
+
+        Direction dirs[STAT_COUNT] = {};
+        Direction goal[STAT_COUNT] = {};
+        for (int k = 0; k < STAT_COUNT; ++k) {
+            int w = opt.objective.*DELTA_FIELDS[k];
+            if (w != 0) {
+                goal[k] = w > 0 ? Direction::Higher : Direction::Lower;
+                addDirection(dirs[k], goal[k]);
+            }
+        }
+        for (const auto* list : {&keep, &require}) {
+            for (const auto& b : *list) {
+                addDirection(dirs[b.stat], b.atLeast ? Direction::Higher : Direction::Lower);
+            }
+        }
+        for (const auto& choice : story.choices) addConditionStats(choice.condition, dirs);
+        for (const auto& rule : story.redirects) addConditionStats(rule.condition, dirs);
+
+        auto score = [&](const Stats& s) {
+            long total = 0;
+            for (int k = 0; k < STAT_COUNT; ++k) total += long(opt.objective.*DELTA_FIELDS[k]) * (s.*STAT_FIELDS[k]);
+            return total;
+        };
+
+        auto t0 = std::chrono::steady_clock::now();
+        const StateCodec codec(story);
+
+        std::vector<Label> labels;
+        std::unordered_map<std::string, std::vector<std::uint32_t>> buckets;  // （场景, flags）-> 存活标签
+        std::vector<std::uint32_t> queue;
+        std::vector<Route> routes;
+        std::size_t pruned = 0;
+
+        auto offer = [&](std::uint32_t scene, const Stats& stats, const FlagSet& flags,
+                         std::uint32_t parent, std::uint32_t choice) {
+            if (!allHold(keep, stats)) return;
+
+            auto& bucket = buckets[codec.encode(scene, Stats{}, flags)];
+            for (auto id : bucket) {
+                if (dominates(labels[id].stats, stats, dirs)) {
+                    ++pruned;
+                    return;
+                }
+            }
+            auto dead = std::remove_if(bucket.begin(), bucket.end(), [&](std::uint32_t id) {
+                if (!dominates(stats, labels[id].stats, dirs)) return false;
+                labels[id].alive = false;
+                ++pruned;
+                return true;
+            });
+            bucket.erase(dead, bucket.end());
+
+            auto id = static_cast<std::uint32_t>(labels.size());
+            labels.push_back(Label{scene, stats, flags, parent, choice});
+            bucket.push_back(id);
+            queue.push_back(id);
+        };
+
+        offer(startScene, Stats{}, FlagSet{}, NO_LABEL, NO_LABEL);
+
+        for (std::size_t head = 0; head < queue.size() && labels.size() < opt.maxStates; ++head) {
+            std::uint32_t id = queue[head];
+            if (!labels[id].alive) continue;
+
+            // offer 可能让 labels 扩容，先拷一份
+            const std::uint32_t scene = labels[id].scene;
+            const Stats stats = labels[id].stats;
+            const FlagSet flags = labels[id].flags;
+            const SceneNode& node = story.scenes[scene];
+
+            bool anyVisible = false;
+            bool anyUntimed = false;
+            for (std::uint32_t ci = node.choiceBegin; ci < node.choiceEnd; ++ci) {
+                const Choice& choice = story.choices[ci];
+                if (!requirementsMet(choice, stats, flags)) continue;
+                anyVisible = true;
+                if (!choice.timed) anyUntimed = true;
+
+                Stats next = stats;
+                applyDelta(next, choice);
+                FlagSet after = flags;
+                for (auto f : choice.setFlagIds) after.set(f);
+
+                std::uint32_t target = resolveNextScene(story, choice, next, after);
+                if (target == NO_SCENE) {
+                    if (allHold(keep, next)) {
+                        routes.push_back({id, ci, next, node.id + " -> " + choice.nextSceneId + "（目标不存在）"});
+                    }
+                    continue;
+                }
+                offer(target, next, after, id, ci);
+            }
+
+            if (!anyVisible) {
+                routes.push_back({id, NO_LABEL, stats, node.id});
+            } else if (!anyUntimed) {
+                routes.push_back({id, NO_LABEL, stats, node.id + "（超时）"});
+            }
+        }
+        const bool truncated = labels.size() >= opt.maxStates;
+
+        // 结局属性的 Pareto 前沿：只比较目标属性，相同属性的路线只留第一条（通常最短）
+        std::vector<Route> candidates;
+        for (auto& r : routes) {
+            if (!allHold(require, r.stats)) continue;
+            bool same = false;
+            for (const auto& c : candidates) {
+                if (dominates(c.stats, r.stats, goal) && dominates(r.stats, c.stats, goal)) {
+                    same = true;
+                    break;
+                }
+            }
+            if (!same) candidates.push_back(std::move(r));
+        }
+        std::vector<Route> frontier;
+        for (std::size_t i = 0; i < candidates.size(); ++i) {
+            bool dominated = false;
+            for (std::size_t j = 0; j < candidates.size() && !dominated; ++j) {
+                dominated = j != i && dominates(candidates[j].stats, candidates[i].stats, goal)
+                         && !dominates(candidates[i].stats, candidates[j].stats, goal);
+            }
+            if (!dominated) frontier.push_back(candidates[i]);
+        }
+        std::sort(frontier.begin(), frontier.end(), [&](const Route& a, const Route& b) {
+            return score(a.stats) > score(b.stats);
+        });
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "求解完成：展开 " << labels.size() << " 个标签，剪掉 " << pruned << " 个，"
+                  << routes.size() << " 条到达结局的路线，用时 "
+                  << std::fixed << std::setprecision(3) << seconds << " 秒\n";
+        if (truncated) {
+            std::cout << "（标签数达到 --max-states 上限 " << opt.maxStates << "，以下结果不完整）\n";
+        }
+        if (frontier.empty()) {
+            std::cout << "没有满足条件的路线\n";
+            return truncated ? 3 : 1;
+        }
+
+        std::cout << "Pareto 前沿共 " << frontier.size() << " 条路线";
+        if (frontier.size() > opt.top) std::cout << "，按得分列出前 " << opt.top << " 条";
+        std::cout << ":\n";
+
+        std::vector<std::uint32_t> path;
+        for (std::size_t i = 0; i < frontier.size() && i < opt.top; ++i) {
+            const Route& r = frontier[i];
+            path.clear();
+            for (std::uint32_t id = r.label; id != NO_LABEL; id = labels[id].parent) path.push_back(id);
+            std::reverse(path.begin(), path.end());
+
+            std::size_t steps = path.size() - 1 + (r.finalChoice != NO_LABEL ? 1 : 0);
+            EndingInfo range;
+            range.add(r.stats);
+            std::cout << "\n#" << (i + 1) << " 得分 " << score(r.stats) << "，结局 " << r.ending
+                      << "，" << steps << " 步: " << describeRange(range) << "\n";
+
+            auto printStep = [&](std::uint32_t scene, std::uint32_t choice) {
+                std::cout << "    " << story.scenes[scene].id << ": \"" << story.choices[choice].text << "\"\n";
+            };
+            for (std::size_t p = 1; p < path.size(); ++p) {
+                printStep(labels[path[p - 1]].scene, labels[path[p]].choice);
+            }
+            if (r.finalChoice != NO_LABEL) printStep(labels[r.label].scene, r.finalChoice);
+        }
+
+        return truncated ? 3 : 0;
+    }
+
+    void printUsage() {
+        std::cerr << "用法: campus_explore [--scenes 目录] [--threads T] [--start 场景ID] [--max-states N]\n"
+                     "       campus_explore --solve 学力=1,名誉=1 [--keep 理智>=0] [--require 理智>=3] [--top N]\n";
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        if (arg == "--scenes") {
+            opt.sceneDir = argv[++i];
+        } else if (arg == "--threads") {
+            parseNumberArg(arg, argv[++i], opt.threads, printUsage);
+        } else if (arg == "--start") {
+            opt.start = argv[++i];
+        } else if (arg == "--max-states") {
+            parseNumberArg(arg, argv[++i], opt.maxStates, printUsage);
+        } else if (arg == "--solve") {
+            opt.solve = true;
+            parseDelta(argv[++i], opt.objective);
+        } else if (arg == "--keep") {
+            opt.keep = argv[++i];
+        } else if (arg == "--require") {
+            opt.require = argv[++i];
+        } else if (arg == "--top") {
+            parseNumberArg(arg, argv[++i], opt.top, printUsage);
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    StoryGraph story = loadStory(opt.sceneDir);
+    std::uint32_t startScene = story.findScene(opt.start);
+    if (startScene == NO_SCENE) {
+        std::cerr << "缺少起始场景 ID: " << opt.start << "\n";
+        return 1;
+    }
+    if (opt.solve) {
+        return solve(story, startScene, opt);
+    }
+
+    const unsigned threads = opt.threads ? opt.threads : defaultThreadCount();
+    const StateCodec codec(story);
+    VisitedSet visited;
+    SeenMarks sceneReached(story.scenes.size());
+    SeenMarks choiceShown(story.choices.size());
+    Endings endings(story.scenes.size(), story.choices.size());
+    std::mutex endingsMutex;
+    std::atomic<bool> truncated{false};
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    // 按层 BFS：每层的前沿切成小块，由各线程用原子计数器动态领取，
+    // 处理慢的块不会拖住其它线程；新状态先在块内攒着，块结束时一次并入下一层
+    std::vector<std::string> frontier{codec.encode(startScene, Stats{}, FlagSet{})};
+    visited.insert(frontier.front());
+    std::size_t depth = 0;
+
+    constexpr std::size_t CHUNK = 256;
+    std::mutex nextMutex;
+
+    while (!frontier.empty()) {
+        std::vector<std::string> next;
+        const std::size_t chunks = (frontier.size() + CHUNK - 1) / CHUNK;
+
+        parallelFor(chunks, threads, [&](std::size_t c) {
+            // 达到上限后剩下的块不再展开，直接领完
+            if (truncated) return;
+
+            std::vector<std::string> found;
+            Endings local(story.scenes.size(), story.choices.size());
+            bool anyEnding = false;
+
+            std::uint32_t scene = NO_SCENE;
+            Stats stats;
+            FlagSet flags;
+            FlagSet after;
+
+            std::size_t end = std::min(frontier.size(), (c + 1) * CHUNK);
+            for (std::size_t s = c * CHUNK; s < end && !truncated; ++s) {
+                codec.decode(frontier[s], scene, stats, flags);
+                sceneReached.mark(scene);
+
+                const SceneNode& node = story.scenes[scene];
+                bool anyVisible = false;
+                bool anyUntimed = false;
+                for (std::uint32_t ci = node.choiceBegin; ci < node.choiceEnd; ++ci) {
+                    const Choice& choice = story.choices[ci];
+                    if (!requirementsMet(choice, stats, flags)) continue;
+                    choiceShown.mark(ci);
+                    anyVisible = true;
+                    if (!choice.timed) anyUntimed = true;
+
+                    Stats nextStats = stats;
+                    applyDelta(nextStats, choice);
+                    after = flags;
+                    for (auto f : choice.setFlagIds) after.set(f);
+
+                    std::uint32_t target = resolveNextScene(story, choice, nextStats, after);
+                    if (target == NO_SCENE) {
+                        local.dangling[ci].add(nextStats);
+                        anyEnding = true;
+                        continue;
+                    }
+
+                    if (visited.size() >= opt.maxStates) {
+                        truncated = true;
+                        break;
+                    }
+                    std::string key = codec.encode(target, nextStats, after);
+                    if (visited.insert(key)) found.push_back(std::move(key));
+                }
+                if (truncated) break;  // 这个状态的选项没有看完，不能据此判断结局
+
+                if (!anyVisible) {
+                    local.stuck[scene].add(stats);
+                    anyEnding = true;
+                } else if (!anyUntimed) {
+                    local.timedOut[scene].add(stats);
+                    anyEnding = true;
+                }
+            }
+
+            if (anyEnding) {
+                std::lock_guard<std::mutex> lock(endingsMutex);
+                endings.merge(local);
+            }
+            if (!found.empty() && !truncated) {
+                std::lock_guard<std::mutex> lock(nextMutex);
+                next.insert(next.end(), std::make_move_iterator(found.begin()),
+                            std::make_move_iterator(found.end()));
+            }
+        });
+
+        frontier.swap(next);
+        if (!frontier.empty()) ++depth;
+        if (truncated) break;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::cout << "探索了 " << visited.size() << " 个不同状态，最深 " << depth << " 步，"
+              << threads << " 线程，用时 " << std::fixed << std::setprecision(3) << seconds << " 秒\n";
+    if (truncated) {
+        std::cout << "（状态数达到 --max-states 上限 " << opt.maxStates << "，以下结果不完整）\n";
+    }
+
+    std::cout << "\n可达结局:\n";
+    for (std::size_t s = 0; s < story.scenes.size(); ++s) {
+        const auto& info = endings.stuck[s];
+        if (info.states) {
+            std::cout << "  " << story.scenes[s].id << "（" << info.states << " 个状态）: "
+                      << describeRange(info) << "\n";
+        }
+    }
+    for (std::size_t s = 0; s < story.scenes.size(); ++s) {
+        const auto& info = endings.timedOut[s];
+        if (info.states) {
+            std::cout << "  " << story.scenes[s].id << " 超时后无可选项（" << info.states << " 个状态）: "
+                      << describeRange(info) << "\n";
+        }
+    }
+    for (std::size_t s = 0; s < story.scenes.size(); ++s) {
+        const SceneNode& node = story.scenes[s];
+        for (std::uint32_t ci = node.choiceBegin; ci < node.choiceEnd; ++ci) {
+            const auto& info = endings.dangling[ci];
+            if (info.states) {
+                std::cout << "  " << node.id << " -> " << story.choices[ci].nextSceneId
+                          << "（目标不存在，选项 \"" << story.choices[ci].text << "\"，"
+                          << info.states << " 个状态）: " << describeRange(info) << "\n";
+            }
+        }
+    }
+
+    std::size_t unreachable = 0;
+    for (std::size_t s = 0; s < story.scenes.size(); ++s) {
+        if (!sceneReached.test(s)) ++unreachable;
+    }
+    std::cout << "\n不可达场景（" << unreachable << " 个）:\n";
+    for (std::size_t s = 0; s < story.scenes.size(); ++s) {
+        if (!sceneReached.test(s)) std::cout << "  " << story.scenes[s].id << "\n";
+    }
+
+    // 只列出可达场景里的选项：不可达场景的选项自然也不会显示
+    std::size_t hidden = 0;
+    for (std::size_t s = 0; s < story.scenes.size(); ++s) {
+        if (!sceneReached.test(s)) continue;
+        const SceneNode& node = story.scenes[s];
+        for (std::uint32_t ci = node.choiceBegin; ci < node.choiceEnd; ++ci) {
+            if (!choiceShown.test(ci)) ++hidden;
+        }
+    }
+    std::cout << "\n可达场景中永远不会显示的选项（" << hidden << " 个）:\n";
+    for (std::size_t s = 0; s < story.scenes.size(); ++s) {
+        if (!sceneReached.test(s)) continue;
+        const SceneNode& node = story.scenes[s];
+        for (std::uint32_t ci = node.choiceBegin; ci < node.choiceEnd; ++ci) {
+            if (choiceShown.test(ci)) continue;
+            const Choice& choice = story.choices[ci];
+            std::cout << "  " << node.id << ": \"" << choice.text << "\"（需要:";
+            for (const auto& term : choice.requirements) std::cout << " " << term;
+            std::cout << "）\n";
+        }
+    }
+
+    return truncated ? 3 : 0;
+}
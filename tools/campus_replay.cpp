@@ -0,0 +1,238 @@
+// campus_replay：回放日志的校验、合成语料和回放吞吐基准
+//
+// 用法：campus_replay play <日志>... [--scenes 目录]
+//       campus_replay gen <输出目录> [--sessions N] [--steps M] [--seed S] [--scenes 目录]
+//       campus_replay bench <语料目录> [--rounds R] [--threads T] [--scenes 目录]
+//
+// play 无界面全速回放每份日志（游戏用 --record 录制），逐步校验属性和 flags，
+// 报告第一处不一致。gen 用随机选择和随机帧时间合成一批会话；bench 把整个目录的日志
+// 读进内存后反复回放，报告每秒会话数 / 选择数，作为引擎的端到端吞吐基准。
+// 剧情图只读，多线程回放时所有线程共用同一份。
+
+#include "cli_args.hpp"
+#include "engine.hpp"
+#include "parallel.hpp"
+#include "replay.hpp"
+#include "rng.hpp"
+#include "scene_bundle.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace CampusSim;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    struct Options {
+        std::string   sceneDir = "scenes";
+        std::size_t   sessions = 10000;
+        std::size_t   steps    = 60;   // 每个会话最多的选择次数（走到结局就提前结束）
+        std::uint64_t seed     = 1;
+        int           rounds   = 5;
+        unsigned      threads  = 1;   // bench 的回放线程数，0 为硬件并发数
+        std::vector<std::string> paths;
+    };
+
+    void printUsage() {
+        std::cerr << "用法: campus_replay play <日志>... [--scenes 目录]\n"
+                     "       campus_replay gen <输出目录> [--sessions N] [--steps M] [--seed S] [--scenes 目录]\n"
+                     "       campus_replay bench <语料目录> [--rounds R] [--threads T] [--scenes 目录]\n";
+    }
+
+    // 一个合成会话：每个选择之前随机过几帧（大多是 1/60 秒，偶尔停顿好几秒，
+    // 让限时选项有机会超时），再从可见选项里随机选一个
+    std::vector<std::uint8_t> synthesizeSession(const StoryGraph& story, const Options& opt, Rng& rng) {
+        Engine engine(story);
+        engine.start("start");
+
+        ReplayRecorder recorder;
+        recorder.openInMemory(engine.snapshot());
+
+        std::vector<std::size_t> visible;
+        for (std::size_t step = 0; step < opt.steps; ++step) {
+            std::size_t frames = 1 + rng.below(30);
+            for (std::size_t f = 0; f < frames; ++f) {
+                float dt = rng.below(20) == 0 ? 0.5f + static_cast<float>(rng.below(4000)) / 1000.f
+                                              : 1.f / 60.f;
+                engine.advance(recorder.frame(dt));
+            }
+
+            engine.visibleChoices(visible);
+            if (visible.empty()) break;  // 结局（或全部超时）
+
+            std::size_t index = visible[rng.below(visible.size())];
+            const std::string from = engine.currentScene().id;
+            engine.choose(index);
+            recorder.choice(static_cast<std::uint32_t>(index), from, engine);
+        }
+        return recorder.take();
+    }
+
+    int runGen(const StoryGraph& story, const Options& opt) {
+        if (opt.paths.size() != 1) {
+            printUsage();
+            return 2;
+        }
+        fs::path dir = opt.paths[0];
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        if (ec) {
+            std::cerr << "无法创建目录 " << dir << ": " << ec.message() << "\n";
+            return 1;
+        }
+
+        Rng rng{opt.seed};
+        std::uint64_t bytes = 0;
+        for (std::size_t s = 0; s < opt.sessions; ++s) {
+            auto log = synthesizeSession(story, opt, rng);
+            char name[40];  // "session_" + 最多 20 位数字 + ".replay"
+            std::snprintf(name, sizeof(name), "session_%05zu.replay", s);
+            std::ofstream out(dir / name, std::ios::binary);
+            if (!out) {
+                std::cerr << "无法写入 " << (dir / name) << "\n";
+                return 1;
+            }
+            out.write(reinterpret_cast<const char*>(log.data()), static_cast<std::streamsize>(log.size()));
+            bytes += log.size();
+        }
+        std::cout << "已生成 " << opt.sessions << " 个会话到 " << dir << "，共 " << bytes << " 字节（平均 "
+                  << (opt.sessions ? bytes / opt.sessions : 0) << " 字节 / 会话）\n";
+        return 0;
+    }
+
+    int runPlay(const StoryGraph& story, const Options& opt) {
+        if (opt.paths.empty()) {
+            printUsage();
+            return 2;
+        }
+        int failures = 0;
+        for (const auto& path : opt.paths) {
+            std::vector<std::uint8_t> log;
+            if (!readReplayFile(path, log)) {
+                ++failures;
+                continue;
+            }
+            ReplayResult result = replaySession(story, log.data(), log.size());
+            if (result.ok) {
+                std::cout << path << ": 一致（" << result.choices << " 次选择，" << result.frames << " 帧）\n";
+            } else {
+                ++failures;
+                std::cout << path << ": 不一致 —— " << result.error << "\n";
+            }
+        }
+        return failures ? 1 : 0;
+    }
+
+    int runBench(const StoryGraph& story, const Options& opt) {
+        if (opt.paths.size() != 1) {
+            printUsage();
+            return 2;
+        }
+
+        std::vector<fs::path> files;
+        std::error_code ec;
+        for (fs::directory_iterator it(opt.paths[0], ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->path().extension() == ".replay") files.push_back(it->path());
+        }
+        std::sort(files.begin(), files.end());
+        if (files.empty()) {
+            std::cerr << "目录里没有 .replay 文件: " << opt.paths[0] << "\n";
+            return 1;
+        }
+
+        // 全部读进内存，计时只包含回放本身
+        std::vector<std::vector<std::uint8_t>> logs(files.size());
+        std::uint64_t bytes = 0;
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            if (!readReplayFile(files[i], logs[i])) return 1;
+            bytes += logs[i].size();
+        }
+
+        std::vector<ReplayResult> results(logs.size());
+        std::vector<double> roundSeconds;
+        for (int r = 0; r < std::max(1, opt.rounds); ++r) {
+            auto t0 = std::chrono::steady_clock::now();
+            parallelFor(logs.size(), opt.threads, [&](std::size_t i) {
+                results[i] = replaySession(story, logs[i].data(), logs[i].size());
+            });
+            roundSeconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+        }
+
+        std::uint64_t choices = 0, frames = 0;
+        int failures = 0;
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            choices += results[i].choices;
+            frames += results[i].frames;
+            if (!results[i].ok && ++failures <= 3) std::cerr << files[i] << ": " << results[i].error << "\n";
+        }
+        std::sort(roundSeconds.begin(), roundSeconds.end());
+        double seconds = roundSeconds[roundSeconds.size() / 2];
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "回放 " << logs.size() << " 个会话（" << bytes << " 字节，" << choices << " 次选择，"
+                  << frames << " 帧），" << (opt.threads ? opt.threads : defaultThreadCount()) << " 线程，"
+                  << roundSeconds.size() << " 轮取中位数:\n"
+                  << "  用时          " << std::setprecision(3) << seconds * 1000.0 << " ms\n"
+                  << std::setprecision(0)
+                  << "  会话 / 秒     " << static_cast<double>(logs.size()) / seconds << "\n"
+                  << "  选择 / 秒     " << static_cast<double>(choices) / seconds << "\n"
+                  << "  帧 / 秒       " << static_cast<double>(frames) / seconds << "\n"
+                  << std::setprecision(1)
+                  << "  每次选择      " << seconds * 1e9 / static_cast<double>(std::max<std::uint64_t>(choices, 1))
+                  << " ns（含其间的帧）\n";
+        if (failures) {
+            std::cerr << failures << " 个会话回放不一致\n";
+            return 1;
+        }
+        return 0;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+    std::string mode = argv[1];
+
+    Options opt;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--scenes" && hasValue) opt.sceneDir = argv[++i];
+        else if (arg == "--sessions" && hasValue) parseNumberArg(arg, argv[++i], opt.sessions, printUsage);
+        else if (arg == "--steps" && hasValue) parseNumberArg(arg, argv[++i], opt.steps, printUsage);
+        else if (arg == "--seed" && hasValue) parseNumberArg(arg, argv[++i], opt.seed, printUsage);
+        else if (arg == "--rounds" && hasValue) parseNumberArg(arg, argv[++i], opt.rounds, printUsage);
+        else if (arg == "--threads" && hasValue) parseNumberArg(arg, argv[++i], opt.threads, printUsage);
+        else if (arg.rfind("--", 0) == 0) {
+            printUsage();
+            return 2;
+        } else {
+            opt.paths.push_back(arg);
+        }
+    }
+
+    StoryGraph story = loadStory(opt.sceneDir);
+    if (story.scenes.empty()) {
+        std::cerr << "未加载到任何场景: " << opt.sceneDir << "\n";
+        return 1;
+    }
+
+    if (mode == "play") return runPlay(story, opt);
+    if (mode == "gen") return runGen(story, opt);
+    if (mode == "bench") return runBench(story, opt);
+    printUsage();
+    return 2;
+}
@@ -0,0 +1,622 @@
+// campus_server：多会话的无界面剧情服务，以及配套的负载发生器
+//
+// 用法：campus_server [--scenes 目录] [--threads T] [--socket 路径] [--idle-timeout 秒]
+//       campus_server load (--socket 路径 | --in-process) [--connections C] [--sessions K]
+//                          [--duration 秒] [--steps M] [--seed S] [--threads T] [--scenes 目录]
+//
+// 剧情图只载入一次、只读共享，每个会话只保存自己的 Engine。协议见 session_server.hpp，
+// 一行请求一行响应。不给 --socket 时从标准输入读请求、响应写到标准输出（单线程，按顺序处理）；
+// 给了 --socket 时在 Unix 域套接字上监听（仅 Unix）：一个 I/O 线程 poll 所有连接，
+// 收到的完整请求行交给 T 个工作线程处理，同一连接的请求按顺序执行，不同连接并行。
+//
+// load 开 C 个连接，每个连接轮流驱动 K 个会话（LIST 后随机 CHOOSE，走到结局或 M 步后
+// END 并重开），跑满指定时长后报告吞吐、每个服务线程的吞吐和请求延迟分位数。
+// --in-process 不经过套接字，直接在本进程里调用协议处理（T 只用于折算，默认取连接数），
+// 用来单独测引擎和协议本身的开销。
+
+#include "cli_args.hpp"
+#include "parallel.hpp"
+#include "rng.hpp"
+#include "scene_bundle.hpp"
+#include "session_server.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CAMPUS_SERVER_SOCKETS 1
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace CampusSim;
+
+namespace {
+
+    // 单行请求的长度上限，超过时断开连接
+    constexpr std::size_t MAX_REQUEST_LINE = 4096;
+
+    struct Options {
+        std::string sceneDir    = "scenes";
+        unsigned    threads     = 0;     // 服务端工作线程数，0 为硬件并发数
+        std::string socketPath;
+        double      idleTimeout = 1800;  // 秒，超过这么久没有请求的会话被结束
+
+        // load
+        bool          inProcess   = false;
+        std::size_t   connections = 8;
+        std::size_t   sessions    = 16;  // 每个连接同时驱动的会话数
+        double        duration    = 5;
+        std::size_t   steps       = 60;
+        std::uint64_t seed        = 1;
+    };
+
+    void printUsage() {
+        std::cerr << "用法: campus_server [--scenes 目录] [--threads T] [--socket 路径] [--idle-timeout 秒]\n"
+                     "       campus_server load (--socket 路径 | --in-process) [--connections C] [--sessions K]\n"
+                     "                          [--duration 秒] [--steps M] [--seed S] [--threads T] [--scenes 目录]\n";
+    }
+
+    // ----------------- 标准输入 / 输出 -----------------
+
+    int serveStdio(SessionServer& server) {
+        std::string line, response;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            bool keep = server.handle(line, response);
+            std::cout << response << '\n';
+            // 管道里还有积压的请求时攒着一起写
+            if (!keep || std::cin.rdbuf()->in_avail() <= 0) std::cout.flush();
+            if (!keep) break;
+        }
+        return 0;
+    }
+
+#ifdef CAMPUS_SERVER_SOCKETS
+
+    // ----------------- Unix 域套接字 -----------------
+
+    volatile std::sig_atomic_t stopRequested = 0;
+
+    void onStopSignal(int) { stopRequested = 1; }
+
+    bool sendAll(int fd, const char* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t n = ::send(fd, data, size, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    bool fillAddress(const std::string& path, sockaddr_un& addr) {
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "套接字路径过长: " << path << "\n";
+            return false;
+        }
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    // 一个客户端连接。I/O 线程负责读，工作线程负责处理和写；
+    // 任一时刻最多一个工作线程持有它（scheduled），所以同一连接的请求按顺序执行
+    struct Connection {
+        explicit Connection(int socket) : fd(socket) {}
+        ~Connection() { ::close(fd); }
+
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        const int fd;
+        std::string partial;  // 只由 I/O 线程访问：还没凑成一整行的数据
+
+        std::mutex mutex;
+        std::vector<std::string> pending;  // 已收到、等待处理的请求行
+        bool scheduled = false;            // 已在任务队列里或正被某个工作线程处理
+        std::atomic<bool> closing{false};  // QUIT 或写失败，不再处理后续请求
+    };
+
+    // 有请求待处理的连接队列
+    class WorkQueue {
+    public:
+        void push(std::shared_ptr<Connection> conn) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                queue_.push_back(std::move(conn));
+            }
+            wake_.notify_one();
+        }
+
+        // 队列关闭且取空后返回 false
+        bool pop(std::shared_ptr<Connection>& conn) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) return false;
+            conn = std::move(queue_.front());
+            queue_.pop_front();
+            return true;
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::deque<std::shared_ptr<Connection>> queue_;
+        bool stop_ = false;
+    };
+
+    // 处理一个连接上积压的全部请求，响应攒成一批再写
+    void workerLoop(SessionServer& server, WorkQueue& queue) {
+        std::shared_ptr<Connection> conn;
+        std::vector<std::string> lines;
+        std::string response, batch;
+        while (queue.pop(conn)) {
+            for (;;) {
+                {
+                    std::lock_guard<std::mutex> lock(conn->mutex);
+                    if (conn->pending.empty() || conn->closing) {
+                        conn->scheduled = false;
+                        break;
+                    }
+                    lines.swap(conn->pending);
+                }
+
+                batch.clear();
+                for (const auto& line : lines) {
+                    bool keep = server.handle(line, response);
+                    batch += response;
+                    batch += '\n';
+                    if (!keep) {
+                        conn->closing = true;
+                        break;
+                    }
+                }
+                lines.clear();
+
+                if (!sendAll(conn->fd, batch.data(), batch.size())) conn->closing = true;
+                // 关闭由 I/O 线程在读到 EOF 后完成
+                if (conn->closing) ::shutdown(conn->fd, SHUT_RDWR);
+            }
+            conn.reset();
+        }
+    }
+
+    int serveSocket(SessionServer& server, const Options& opt, unsigned threads) {
+        sockaddr_un addr;
+        if (!fillAddress(opt.socketPath, addr)) return 1;
+
+        int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0) {
+            std::cerr << "无法创建套接字: " << std::strerror(errno) << "\n";
+            return 1;
+        }
+        ::unlink(opt.socketPath.c_str());
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::listen(listenFd, SOMAXCONN) < 0) {
+            std::cerr << "无法监听 " << opt.socketPath << ": " << std::strerror(errno) << "\n";
+            ::close(listenFd);
+            return 1;
+        }
+        ::fcntl(listenFd, F_SETFL, ::fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+
+        std::signal(SIGPIPE, SIG_IGN);
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+
+        WorkQueue queue;
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back(workerLoop, std::ref(server), std::ref(queue));
+        }
+        std::cout << "在 " << opt.socketPath << " 上监听，" << threads << " 个工作线程（Ctrl+C 退出）\n";
+
+        // fds[0] 是监听套接字，fds[i] 对应 conns[i - 1]
+        std::vector<pollfd> fds{{listenFd, POLLIN, 0}};
+        std::vector<std::shared_ptr<Connection>> conns;
+        std::vector<std::string> lines;
+        char buffer[64 * 1024];
+
+        auto idleTimeout = std::chrono::duration_cast<SessionServer::Clock::duration>(
+            std::chrono::duration<double>(opt.idleTimeout));
+        auto lastSweep = SessionServer::Clock::now();
+
+        while (!stopRequested) {
+            int ready = ::poll(fds.data(), static_cast<nfds_t>(fds.size()), 500);
+            if (ready < 0 && errno != EINTR) {
+                std::cerr << "poll 失败: " << std::strerror(errno) << "\n";
+                break;
+            }
+
+            if (ready > 0) {
+                for (std::size_t i = fds.size(); i-- > 1;) {
+                    if (!fds[i].revents) continue;
+                    auto& conn = conns[i - 1];
+
+                    ssize_t n = ::read(conn->fd, buffer, sizeof(buffer));
+                    bool drop = n <= 0 && !(n < 0 && errno == EINTR);
+                    if (n > 0 && !conn->closing) {
+                        conn->partial.append(buffer, static_cast<std::size_t>(n));
+
+                        std::size_t start = 0;
+                        for (std::size_t nl; (nl = conn->partial.find('\n', start)) != std::string::npos; start = nl + 1) {
+                            std::size_t end = nl > start && conn->partial[nl - 1] == '\r' ? nl - 1 : nl;
+                            lines.emplace_back(conn->partial, start, end - start);
+                        }
+                        conn->partial.erase(0, start);
+                        if (conn->partial.size() > MAX_REQUEST_LINE) drop = true;
+
+                        if (!lines.empty()) {
+                            bool schedule = false;
+                            {
+                                std::lock_guard<std::mutex> lock(conn->mutex);
+                                for (auto& line : lines) conn->pending.push_back(std::move(line));
+                                schedule = !conn->scheduled;
+                                conn->scheduled = true;
+                            }
+                            lines.clear();
+                            if (schedule) queue.push(conn);
+                        }
+                    }
+
+                    if (drop) {
+                        // 工作线程可能还持有它，最后一个引用释放时才关闭描述符
+                        conn->closing = true;
+                        fds[i] = fds.back();
+                        fds.pop_back();
+                        conn = std::move(conns.back());
+                        conns.pop_back();
+                    }
+                }
+
+                if (fds[0].revents & POLLIN) {
+                    for (;;) {
+                        int fd = ::accept(listenFd, nullptr, nullptr);
+                        if (fd < 0) break;
+                        fds.push_back({fd, POLLIN, 0});
+                        conns.push_back(std::make_shared<Connection>(fd));
+                    }
+                }
+            }
+
+            auto now = SessionServer::Clock::now();
+            if (now - lastSweep > std::chrono::seconds(10)) {
+                lastSweep = now;
+                std::size_t expired = server.expireIdle(idleTimeout);
+                if (expired) std::cout << "结束了 " << expired << " 个空闲会话\n";
+            }
+        }
+
+        std::cout << "正在退出（" << server.sessionCount() << " 个会话）\n";
+        queue.stop();
+        for (auto& t : workers) t.join();
+        conns.clear();
+        ::close(listenFd);
+        ::unlink(opt.socketPath.c_str());
+        return 0;
+    }
+
+    // 负载发生器的套接字客户端：一问一答
+    class SocketClient {
+    public:
+        ~SocketClient() {
+            if (fd_ >= 0) ::close(fd_);
+        }
+
+        bool connect(const std::string& path) {
+            sockaddr_un addr;
+            if (!fillAddress(path, addr)) return false;
+            fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd_ < 0 || ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+                std::cerr << "无法连接 " << path << ": " << std::strerror(errno) << "\n";
+                return false;
+            }
+            return true;
+        }
+
+        bool request(const std::string& line, std::string& response) {
+            request_ = line;
+            request_ += '\n';
+            if (!sendAll(fd_, request_.data(), request_.size())) return false;
+
+            std::size_t nl;
+            while ((nl = input_.find('\n')) == std::string::npos) {
+                char buffer[4096];
+                ssize_t n = ::read(fd_, buffer, sizeof(buffer));
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return false;
+                input_.append(buffer, static_cast<std::size_t>(n));
+            }
+            response.assign(input_, 0, nl);
+            input_.erase(0, nl + 1);
+            return true;
+        }
+
+    private:
+        int fd_ = -1;
+        std::string request_;
+        std::string input_;
+    };
+
+#endif // CAMPUS_SERVER_SOCKETS
+
+    // ----------------- 负载发生器 -----------------
+
+    class InProcessClient {
+    public:
+        explicit InProcessClient(SessionServer& server) : server_(server) {}
+
+        bool request(const std::string& line, std::string& response) {
+            server_.handle(line, response);
+            return true;
+        }
+
+    private:
+        SessionServer& server_;
+    };
+
+    struct LoadStats {
+        std::vector<std::uint32_t> latencyNs;  // 每个请求一项
+        std::uint64_t completed = 0;           // 走完（结局或步数上限）的会话
+        std::uint64_t errors    = 0;           // ERR 响应
+        bool          failed    = false;       // 连接断开
+    };
+
+    // 一个连接上轮流驱动 opt.sessions 个会话，直到 deadline
+    template <typename Client>
+    void driveLoad(Client& client, const Options& opt, Rng rng,
+                   std::chrono::steady_clock::time_point deadline, LoadStats& stats) {
+        using Clock = std::chrono::steady_clock;
+
+        std::string response;
+        auto call = [&](const std::string& line) {
+            auto t0 = Clock::now();
+            if (!client.request(line, response)) {
+                stats.failed = true;
+                return false;
+            }
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+            stats.latencyNs.push_back(static_cast<std::uint32_t>(std::min<long long>(ns, UINT32_MAX)));
+            if (response.compare(0, 2, "OK") != 0) {
+                ++stats.errors;
+                return false;
+            }
+            return true;
+        };
+
+        struct Live {
+            std::string id;
+            std::size_t steps = 0;
+        };
+        std::vector<Live> live(opt.sessions);
+        auto open = [&](Live& s) {
+            s.steps = 0;
+            s.id.clear();
+            if (call("NEW")) s.id = response.substr(3, response.find(' ', 3) - 3);
+        };
+        for (auto& s : live) open(s);
+
+        std::vector<std::string> visible;
+        while (!stats.failed && Clock::now() < deadline) {
+            for (auto& s : live) {
+                if (stats.failed) break;
+                if (s.id.empty()) {
+                    open(s);
+                    continue;
+                }
+
+                // "OK <场景> <数目>\t<下标> <倒计时> <文本>\t..."
+                visible.clear();
+                if (call("LIST " + s.id)) {
+                    for (std::size_t tab = response.find('\t'); tab != std::string::npos;
+                         tab = response.find('\t', tab + 1)) {
+                        visible.push_back(response.substr(tab + 1, response.find(' ', tab + 1) - tab - 1));
+                    }
+                }
+
+                if (visible.empty() || s.steps >= opt.steps) {
+                    call("END " + s.id);
+                    ++stats.completed;
+                    open(s);
+                    continue;
+                }
+                call("CHOOSE " + s.id + " " + visible[rng.below(visible.size())]);
+                ++s.steps;
+            }
+        }
+
+        // 收尾：结束还开着的会话，不计入延迟
+        std::size_t measured = stats.latencyNs.size();
+        for (auto& s : live) {
+            if (!stats.failed && !s.id.empty()) call("END " + s.id);
+        }
+        stats.latencyNs.resize(std::min(measured, stats.latencyNs.size()));
+    }
+
+    int runLoad(const Options& opt) {
+        using Clock = std::chrono::steady_clock;
+
+        std::unique_ptr<StoryGraph> story;
+        std::unique_ptr<SessionServer> server;
+        // 进程内时真正并发的是各连接线程，--threads 只用于折算
+        unsigned serverThreads = opt.threads ? opt.threads : defaultThreadCount();
+        if (opt.inProcess && !opt.threads) {
+            serverThreads = static_cast<unsigned>(std::min<std::size_t>(opt.connections, serverThreads));
+        }
+        if (opt.inProcess) {
+            story = std::make_unique<StoryGraph>(loadStory(opt.sceneDir));
+            if (story->scenes.empty()) {
+                std::cerr << "未加载到任何场景: " << opt.sceneDir << "\n";
+                return 1;
+            }
+            server = std::make_unique<SessionServer>(*story, serverThreads);
+        } else {
+#ifndef CAMPUS_SERVER_SOCKETS
+            std::cerr << "此平台不支持 Unix 域套接字，请用 --in-process\n";
+            return 2;
+#else
+            if (opt.socketPath.empty()) {
+                printUsage();
+                return 2;
+            }
+#endif
+        }
+
+        std::vector<LoadStats> stats(opt.connections);
+        auto t0 = Clock::now();
+        auto deadline = t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.duration));
+
+        std::vector<std::thread> threads;
+        for (std::size_t c = 0; c < opt.connections; ++c) {
+            Rng rng{opt.seed + c * 0x9E3779B97F4A7C15ull};
+            threads.emplace_back([&, c, rng]() {
+                if (server) {
+                    InProcessClient client(*server);
+                    driveLoad(client, opt, rng, deadline, stats[c]);
+                    return;
+                }
+#ifdef CAMPUS_SERVER_SOCKETS
+                SocketClient client;
+                if (!client.connect(opt.socketPath)) {
+                    stats[c].failed = true;
+                    return;
+                }
+                driveLoad(client, opt, rng, deadline, stats[c]);
+#endif
+            });
+        }
+        for (auto& t : threads) t.join();
+        double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        // 服务端的线程数以它自己报告的为准
+#ifdef CAMPUS_SERVER_SOCKETS
+        if (!server) {
+            SocketClient client;
+            std::string info;
+            if (client.connect(opt.socketPath) && client.request("INFO", info)) {
+                std::size_t at = info.find("threads=");
+                if (at != std::string::npos) parseNumber(std::string_view(info).substr(at + 8), serverThreads);
+            }
+        }
+#endif
+
+        std::vector<std::uint32_t> latency;
+        std::uint64_t completed = 0, errors = 0;
+        std::size_t failedConnections = 0;
+        for (auto& s : stats) {
+            latency.insert(latency.end(), s.latencyNs.begin(), s.latencyNs.end());
+            completed += s.completed;
+            errors += s.errors;
+            if (s.failed) ++failedConnections;
+        }
+        if (latency.empty()) {
+            std::cerr << "没有完成任何请求\n";
+            return 1;
+        }
+        std::sort(latency.begin(), latency.end());
+        auto percentile = [&](double p) {
+            std::size_t i = std::min(latency.size() - 1, static_cast<std::size_t>(p * static_cast<double>(latency.size())));
+            return latency[i] / 1000.0;
+        };
+
+        const double requests = static_cast<double>(latency.size());
+        const std::size_t concurrent = opt.connections * opt.sessions;
+        std::cout << std::fixed << std::setprecision(0)
+                  << (opt.inProcess ? "进程内" : opt.socketPath) << "：" << opt.connections << " 个连接 × "
+                  << opt.sessions << " 个会话 = " << concurrent << " 个并发会话，"
+                  << std::setprecision(1) << seconds << " 秒，服务端 " << serverThreads << " 线程\n"
+                  << std::setprecision(0)
+                  << "  请求          " << requests << "（" << requests / seconds << " / 秒，每线程 "
+                  << requests / seconds / serverThreads << " / 秒）\n"
+                  << "  走完的会话    " << completed << "（" << static_cast<double>(completed) / seconds
+                  << " / 秒，每线程 " << static_cast<double>(completed) / seconds / serverThreads << " / 秒）\n"
+                  << "  每线程并发    " << static_cast<double>(concurrent) / serverThreads << " 个会话\n"
+                  << std::setprecision(1)
+                  << "  延迟（微秒）  p50 " << percentile(0.50) << "  p90 " << percentile(0.90)
+                  << "  p99 " << percentile(0.99) << "  p99.9 " << percentile(0.999)
+                  << "  最大 " << latency.back() / 1000.0 << "\n";
+        if (errors) std::cout << "  错误响应      " << errors << "\n";
+        if (failedConnections) {
+            std::cerr << failedConnections << " 个连接中途断开\n";
+            return 1;
+        }
+        return 0;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    bool load = argc > 1 && std::string(argv[1]) == "load";
+    for (int i = load ? 2 : 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--scenes" && hasValue) opt.sceneDir = argv[++i];
+        else if (arg == "--threads" && hasValue) parseNumberArg(arg, argv[++i], opt.threads, printUsage);
+        else if (arg == "--socket" && hasValue) opt.socketPath = argv[++i];
+        else if (arg == "--idle-timeout" && hasValue) parseNumberArg(arg, argv[++i], opt.idleTimeout, printUsage);
+        else if (arg == "--in-process" && load) opt.inProcess = true;
+        else if (arg == "--connections" && hasValue) parseNumberArg(arg, argv[++i], opt.connections, printUsage);
+        else if (arg == "--sessions" && hasValue) parseNumberArg(arg, argv[++i], opt.sessions, printUsage);
+        else if (arg == "--duration" && hasValue) parseNumberArg(arg, argv[++i], opt.duration, printUsage);
+        else if (arg == "--steps" && hasValue) parseNumberArg(arg, argv[++i], opt.steps, printUsage);
+        else if (arg == "--seed" && hasValue) parseNumberArg(arg, argv[++i], opt.seed, printUsage);
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    opt.connections = std::max<std::size_t>(1, opt.connections);
+    opt.sessions    = std::max<std::size_t>(1, opt.sessions);
+
+    if (load) return runLoad(opt);
+
+    StoryGraph story = loadStory(opt.sceneDir);
+    if (story.scenes.empty()) {
+        std::cerr << "未加载到任何场景: " << opt.sceneDir << "\n";
+        return 1;
+    }
+
+    if (opt.socketPath.empty()) {
+        SessionServer server(story);
+        return serveStdio(server);
+    }
+#ifdef CAMPUS_SERVER_SOCKETS
+    unsigned threads = opt.threads ? opt.threads : defaultThreadCount();
+    SessionServer server(story, threads);
+    return serveSocket(server, opt, threads);
+#else
+    std::cerr << "此平台不支持 Unix 域套接字，请不带 --socket 运行（标准输入 / 输出）\n";
+    return 2;
+#endif
+}
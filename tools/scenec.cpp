@@ -0,0 +1,36 @@
+// scenec：把 scenes 目录编译成游戏可直接内存映射的二进制剧情包
+//
+// 用法：scenec [场景目录] [输出文件]
+//       默认为 scenes 和 scenes.bundle，在游戏运行目录下执行即可
+
+#include "scene.hpp"
+#include "scene_bundle.hpp"
+#include "story_graph.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    std::string sceneDir = (argc > 1) ? argv[1] : "scenes";
+    std::string outPath  = (argc > 2) ? argv[2] : CampusSim::SCENE_BUNDLE_PATH;
+
+    auto scenes = CampusSim::loadScenes(sceneDir);
+    if (scenes.empty()) {
+        std::cerr << "未加载到任何场景: " << sceneDir << "\n";
+        return 1;
+    }
+
+    // 链接时会报告所有悬空的目标场景
+    auto graph = CampusSim::buildStoryGraph(std::move(scenes));
+
+    std::uint64_t fingerprint = CampusSim::fingerprintSceneDir(sceneDir);
+    if (!CampusSim::writeSceneBundle(graph, fingerprint, outPath)) {
+        return 1;
+    }
+
+    std::cout << "已生成 " << outPath << ": " << graph.scenes.size() << " 个场景, "
+              << graph.choices.size() << " 个选项, "
+              << std::filesystem::file_size(outPath) << " 字节\n";
+    return 0;
+}